@@ -0,0 +1,110 @@
+// Micro-benchmark of the page matching inner loop: the former per-line
+// tolower + std::string::find path against Matcher, on deterministic synthetic text.
+// The needle is also run as a regular expression on 4 KiB pages, where the literal prefilter skips most of them.
+//
+// usage: pdfms_match_bench [<megabytes>] [<needle>]
+
+#include "../src/RegexMatcher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+static std::string make_text(size_t bytes) {
+	static const char* words[] = {
+		"the", "of", "and", "Specification", "PERFORMANCE", "system", "manual", "section", "ISO", "9001",
+		"Requirements", "shall", "be", "documented", "in", "accordance", "with", "clause", "table", "figure",
+	};
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> word(0, sizeof(words) / sizeof(words[0]) - 1);
+	std::uniform_int_distribution<int> lineLen(4, 14);
+	std::string text;
+	text.reserve(bytes + 128);
+	while (text.size() < bytes) {
+		int n = lineLen(rng);
+		for (int i = 0; i < n; ++i) {
+			if (i) text += ' ';
+			text += words[word(rng)];
+		}
+		text += '\n';
+	}
+	return text;
+}
+
+template<typename F>
+static void run(const char* name, const std::string& text, F&& f) {
+	size_t hits = 0;
+	auto start = std::chrono::steady_clock::now();
+	const int reps = 3;
+	for (int r = 0; r < reps; ++r)
+		hits = f();
+	double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / reps;
+	std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(3)
+			  << std::setw(8) << (text.size() / s / 1e9) << " GB/s  " << hits << " hits\n";
+}
+
+int main(int argc, char* argv[]) {
+	size_t mb = argc > 1 ? std::stoul(argv[1]) : 64;
+	std::string needle = argc > 2 ? argv[2] : "performance";
+	std::string text = make_text(mb << 20);
+	std::string needleLower = needle;
+	std::transform(needleLower.begin(), needleLower.end(), needleLower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+	std::cout << (text.size() >> 20) << " MB, needle \"" << needle << "\"\n";
+
+	run("getline + tolower + find", text, [&]() {
+		size_t hits = 0;
+		std::istringstream iss(text);
+		std::string line;
+		while (std::getline(iss, line)) {
+			std::string lower = line;
+			std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+			if (lower.find(needleLower) != std::string::npos) ++hits;
+		}
+		return hits;
+	});
+
+	Matcher matcher(needleLower);
+	run("getline + Matcher", text, [&]() {
+		size_t hits = 0;
+		std::istringstream iss(text);
+		std::string line;
+		while (std::getline(iss, line))
+			if (matcher.find(line) != std::string_view::npos) ++hits;
+		return hits;
+	});
+
+	run("Matcher on whole buffer", text, [&]() {
+		size_t hits = 0;
+		std::string_view view(text);
+		for (size_t pos = matcher.find(view); pos != std::string_view::npos; pos = matcher.find(view, pos)) {
+			++hits; // count matching lines, like the line based variants
+			pos = view.find('\n', pos);
+			if (pos == std::string_view::npos) break;
+		}
+		return hits;
+	});
+
+	RegexPageMatcher regex({ needle });
+	run("RegexPageMatcher per page", text, [&]() {
+		size_t hits = 0;
+		std::string_view view(text);
+		for (size_t start = 0; start < view.size();) {
+			size_t end = view.find('\n', std::min(view.size(), start + 4096));
+			end = end == std::string_view::npos ? view.size() : end + 1;
+			std::string_view page = view.substr(start, end - start);
+			regex.scan(page, [&](size_t pos, size_t, int) -> size_t {
+				++hits;
+				size_t line_end = page.find('\n', pos);
+				return line_end == std::string_view::npos ? page.size() : line_end;
+			});
+			start = end;
+		}
+		return hits;
+	});
+	return 0;
+}
@@ -0,0 +1,287 @@
+// Benchmark harness: generates a deterministic synthetic PDF corpus and times every stage of a search
+// separately (walk, read, Poppler load, text extraction, matching, output) plus the whole pipeline.
+// Results are written as JSON so runs can be diffed across versions and thread counts.
+//
+// usage: pdfms_bench [--corpus <dir>] [-j <threads>] [--pattern <word>] [--scale <factor>] [--regenerate]
+
+#include "../src/util.hpp"
+#include "../src/SearchThreads.hpp"
+
+namespace {
+
+// --- Corpus generation ---
+
+// Minimal PDF 1.4 writer with a correct xref table
+class PdfWriter {
+	std::string out = "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n";
+	std::vector<size_t> offsets;
+public:
+	int next_id() const { return (int)offsets.size() + 1; }
+
+	int add(const std::string& body) {
+		offsets.push_back(out.size());
+		out += std::to_string(offsets.size()) + " 0 obj\n" + body + "\nendobj\n";
+		return (int)offsets.size();
+	}
+
+	static std::string stream(const std::string& dict, const std::string& data) {
+		return "<< " + dict + " /Length " + std::to_string(data.size()) + " >>\nstream\n" + data + "\nendstream";
+	}
+
+	std::string finish(int root) {
+		size_t xref = out.size();
+		out += "xref\n0 " + std::to_string(offsets.size() + 1) + "\n0000000000 65535 f \n";
+		char entry[32];
+		for (size_t off : offsets) {
+			snprintf(entry, sizeof(entry), "%010zu 00000 n \n", off);
+			out += entry;
+		}
+		out += "trailer\n<< /Size " + std::to_string(offsets.size() + 1) + " /Root " + std::to_string(root) + " 0 R >>\n";
+		out += "startxref\n" + std::to_string(xref) + "\n%%EOF\n";
+		return out;
+	}
+};
+
+const char* words[] = {
+	"the", "of", "and", "specification", "performance", "system", "manual", "section", "ISO", "9001",
+	"requirements", "shall", "be", "documented", "in", "accordance", "with", "clause", "table", "figure",
+	"maintenance", "procedure", "operator", "safety", "valve", "pressure", "temperature", "revision", "annex", "scope",
+};
+
+// Pages of text or, for scanned documents, a single image per page
+std::string make_pdf(std::mt19937& rng, int pages, bool scanned) {
+	std::uniform_int_distribution<int> word(0, sizeof(words) / sizeof(words[0]) - 1);
+	PdfWriter w;
+	// Object ids: 1 catalog, 2 page tree, 3 font or image, then page + content per page
+	const int first_page = 4;
+	std::string kids;
+	for (int p = 0; p < pages; ++p)
+		kids += std::to_string(first_page + 2 * p) + " 0 R ";
+
+	w.add("<< /Type /Catalog /Pages 2 0 R >>");
+	w.add("<< /Type /Pages /Kids [" + kids + "] /Count " + std::to_string(pages) + " >>");
+	if (scanned)
+		w.add(PdfWriter::stream("/Type /XObject /Subtype /Image /Width 8 /Height 8 /ColorSpace /DeviceGray /BitsPerComponent 8", std::string(64, '\x80')));
+	else
+		w.add("<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica >>");
+
+	const std::string resources = scanned ? "<< /XObject << /Im1 3 0 R >> >>" : "<< /Font << /F1 3 0 R >> >>";
+	for (int p = 0; p < pages; ++p) {
+		std::string content;
+		if (scanned) {
+			content = "q 500 0 0 700 50 50 cm /Im1 Do Q";
+		} else {
+			content = "BT /F1 10 Tf 12 TL 50 770 Td\n";
+			for (int line = 0; line < 55; ++line) {
+				content += "(";
+				for (int k = 0; k < 10; ++k) {
+					if (k) content += ' ';
+					content += words[word(rng)];
+				}
+				content += ") Tj T*\n";
+			}
+			content += "ET";
+		}
+		w.add("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] /Resources " + resources +
+			  " /Contents " + std::to_string(w.next_id() + 1) + " 0 R >>");
+		w.add(PdfWriter::stream("", content));
+	}
+	return w.finish(1);
+}
+
+void write_file(const fs::path& path, const std::string& data) {
+	fs::create_directories(path.parent_path());
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(data.data(), data.size());
+}
+
+// Many small documents in nested directories, a few huge ones, image-only scans and malformed files
+void generate_corpus(const fs::path& dir, int scale) {
+	std::mt19937 rng(20240601);
+	std::uniform_int_distribution<int> small_pages(1, 6);
+	std::uniform_int_distribution<int> scan_pages(1, 4);
+	std::error_code ec;
+	fs::remove_all(dir, ec);
+
+	for (int i = 0; i < 400 * scale; ++i) {
+		fs::path sub = dir / "small" / ("d" + std::to_string(i % 16)) / ("e" + std::to_string(i % 5));
+		write_file(sub / ("doc" + std::to_string(i) + ".pdf"), make_pdf(rng, small_pages(rng), false));
+	}
+	for (int i = 0; i < 3 * scale; ++i)
+		write_file(dir / "huge" / ("manual" + std::to_string(i) + ".pdf"), make_pdf(rng, 1500, false));
+	for (int i = 0; i < 40 * scale; ++i)
+		write_file(dir / "scanned" / ("scan" + std::to_string(i) + ".pdf"), make_pdf(rng, scan_pages(rng), true));
+	for (int i = 0; i < 10 * scale; ++i) {
+		std::string pdf = make_pdf(rng, 3, false);
+		if (i % 3 == 0) pdf.resize(pdf.size() / 2);					// truncated, no xref
+		else if (i % 3 == 1) pdf.replace(pdf.find("xref"), 4, "xxxx");	// broken xref, Poppler has to reconstruct
+		else pdf = std::string(4096, '\x5a');							// not a PDF at all
+		write_file(dir / "malformed" / ("bad" + std::to_string(i) + ".pdf"), pdf);
+	}
+	write_file(dir / "corpus.version", "1 " + std::to_string(scale) + "\n");
+}
+
+// --- Measurement ---
+
+// Runs f(i) for i in [0, n) on threads threads, returns the wall time in seconds
+template<typename F>
+double parallel_for(size_t n, size_t threads, F&& f) {
+	std::atomic<size_t> next{ 0 };
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> pool;
+	for (size_t t = 0; t < threads; ++t)
+		pool.emplace_back([&]() {
+			for (size_t i = next++; i < n; i = next++) f(i);
+		});
+	for (auto& t : pool) t.join();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<typename F>
+double timed(F&& f) {
+	auto start = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double per_s(double amount, double seconds) { return seconds > 0 ? amount / seconds : 0; }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	pdf::suppress_poppler_stderr();
+
+	fs::path corpus = fs::temp_directory_path() / "pdfms_bench_corpus";
+	size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency() - 1);
+	std::string pattern = "maintenance procedure";
+	int scale = 1;
+	bool regenerate = false;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg == "--corpus" && i + 1 < argc) corpus = argv[++i];
+		else if (arg == "-j" && i + 1 < argc) threads = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+		else if (arg == "--pattern" && i + 1 < argc) pattern = argv[++i];
+		else if (arg == "--scale" && i + 1 < argc) scale = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--regenerate") regenerate = true;
+		else {
+			std::cout << "Usage: " << argv[0] << " [--corpus <dir>] [-j <threads>] [--pattern <word>] [--scale <factor>] [--regenerate]\n";
+			return 1;
+		}
+	}
+
+	// Regenerate only when missing or made with other parameters, so repeated runs measure the same bytes
+	{
+		std::ifstream version(corpus / "corpus.version");
+		std::string v;
+		std::getline(version, v);
+		if (regenerate || v != "1 " + std::to_string(scale))
+			generate_corpus(corpus, scale);
+	}
+
+	// --- Walk ---
+	std::vector<fs::path> files;
+	double walk_s = timed([&]() { files = pdf::get_pdf_files(corpus, false, 4); });
+	const size_t n = files.size();
+
+	// --- Read ---
+	std::vector<std::vector<char>> data(n);
+	double read_s = parallel_for(n, threads, [&](size_t i) {
+		std::error_code ec;
+		data[i].resize(size_t(fs::file_size(files[i], ec)));
+		pdf::read_file_into(files[i], data[i].data(), data[i].size());
+	});
+	uint64_t bytes = 0;
+	for (auto& d : data) bytes += d.size();
+
+	// --- Poppler load ---
+	std::vector<std::unique_ptr<poppler::document>> docs(n);
+	double load_s = parallel_for(n, threads, [&](size_t i) {
+		try {
+			docs[i].reset(poppler::document::load_from_raw_data(data[i].data(), int(data[i].size())));
+		} catch (...) {}
+	});
+	size_t load_errors = std::count(docs.begin(), docs.end(), nullptr);
+
+	// --- Text extraction ---
+	std::vector<std::vector<std::string>> text(n);
+	double extract_s = parallel_for(n, threads, [&](size_t i) {
+		if (!docs[i]) return;
+		text[i].resize(docs[i]->pages());
+		for (int p = 0; p < docs[i]->pages(); ++p) {
+			auto page = std::unique_ptr<poppler::page>(docs[i]->create_page(p));
+			if (!page) continue;
+			pdf::page_text(*page, text[i][p]);
+		}
+	});
+	docs.clear();
+	data.clear();
+	uint64_t pages = 0, text_bytes = 0, empty_pages = 0;
+	for (auto& doc : text)
+		for (auto& p : doc) {
+			pages++;
+			text_bytes += p.size();
+			empty_pages += p.empty();
+		}
+
+	// --- Matching ---
+	std::string pattern_lower = pdf::tolower(pattern);
+	LiteralPageMatcher matcher(pattern_lower);
+	std::vector<std::vector<int>> hit_pages(n);
+	double match_s = parallel_for(n, threads, [&](size_t i) {
+		for (size_t p = 0; p < text[i].size(); ++p)
+			matcher.scan(text[i][p], [&](size_t pos, size_t, int) {
+				if (hit_pages[i].empty() || hit_pages[i].back() != int(p) + 1) hit_pages[i].push_back(int(p) + 1);
+				return pos + 1;
+			});
+	});
+	size_t hits = 0;
+	for (auto& h : hit_pages) hits += h.size();
+
+	// --- Output, formatted like the result display ---
+	std::ostringstream sink;
+	size_t results = 0;
+	double output_s = timed([&]() {
+		for (size_t i = 0; i < n; ++i) {
+			if (hit_pages[i].empty()) continue;
+			results++;
+			sink << files[i].filename().string() << "\n\t";
+			for (size_t j = 0; j < hit_pages[i].size(); ++j)
+				sink << (j ? ", " : "") << hit_pages[i][j];
+			sink << "\n";
+		}
+	});
+
+	// --- Whole pipeline ---
+	double pipeline_s;
+	{
+		SearchedFiles sf;
+		sf.searchWords.push_back(pattern);
+		sf.pdfFileNames = files;
+		sf.total_files = n;
+		SearchThreads st(&sf);
+		st.num_threads = threads;
+		pipeline_s = timed([&]() {
+			st.search();
+			st.join();
+		});
+	}
+
+	const double mb = bytes / 1e6, text_mb = text_bytes / 1e6;
+	std::cout << std::fixed << std::setprecision(4)
+			  << "{\n"
+			  << "  \"threads\": " << threads << ",\n"
+			  << "  \"pattern\": " << json::quote(pattern) << ",\n"
+			  << "  \"corpus\": { \"files\": " << n << ", \"bytes\": " << bytes << ", \"pages\": " << pages
+			  << ", \"empty_pages\": " << empty_pages << ", \"text_bytes\": " << text_bytes << ", \"load_errors\": " << load_errors << " },\n"
+			  << "  \"stages\": {\n"
+			  << "    \"walk\": { \"seconds\": " << walk_s << ", \"files_per_s\": " << per_s(n, walk_s) << " },\n"
+			  << "    \"read\": { \"seconds\": " << read_s << ", \"mb_per_s\": " << per_s(mb, read_s) << " },\n"
+			  << "    \"load\": { \"seconds\": " << load_s << ", \"files_per_s\": " << per_s(n, load_s) << ", \"mb_per_s\": " << per_s(mb, load_s) << " },\n"
+			  << "    \"extract\": { \"seconds\": " << extract_s << ", \"pages_per_s\": " << per_s(pages, extract_s) << ", \"text_mb_per_s\": " << per_s(text_mb, extract_s) << " },\n"
+			  << "    \"match\": { \"seconds\": " << match_s << ", \"pages_per_s\": " << per_s(pages, match_s) << ", \"text_mb_per_s\": " << per_s(text_mb, match_s) << ", \"hit_pages\": " << hits << " },\n"
+			  << "    \"output\": { \"seconds\": " << output_s << ", \"results\": " << results << ", \"bytes\": " << sink.str().size() << " },\n"
+			  << "    \"pipeline\": { \"seconds\": " << pipeline_s << ", \"pages_per_s\": " << per_s(pages, pipeline_s) << ", \"mb_per_s\": " << per_s(mb, pipeline_s) << " }\n"
+			  << "  }\n"
+			  << "}\n";
+	return 0;
+}
@@ -1,54 +1,277 @@
 #include "src/util.hpp"
-#include "src/SearchThreads.hpp"
+#include "src/SearchEngine.hpp"
 #include "src/OutThread.hpp"
+#include "src/SearchServer.hpp"
+#include "src/Coordinator.hpp"
+#include "src/Index.hpp"
 
 int main(int argc, char* argv[]) {
 	pdf::suppress_poppler_stderr();
 	terminal::enable_ansi_escape_codes();
 
 	// --- Settings ---
-	bool shuffle = false;
-	bool sort_result = false;
-	bool print_line = false;
-	bool print_path = false;
+	bool print_stats = false;
+	fs::path stats_json; // "-" for stdout
+	fs::path pattern_file;
+	fs::path socket_path; // --serve and --client
+	std::string listen_address; // --serve over TCP
+	std::string workers; // --workers host:port,...
+	std::string token = std::getenv("PDFMS_TOKEN") ? std::getenv("PDFMS_TOKEN") : ""; // --token, kept out of ps by the variable
+	std::string region; // --region x,y,width,height
+	std::string rank = "hits"; // --rank of --top
 	std::string directory;
-	SearchedFiles sf;
+	SearchEngine::Options options;
+	SearchEngine::Query query;
+	OutThread ot(nullptr); // prints the search once it started
+
+	// --- Subcommands ---
+	enum class Mode { search, index, query, serve, client, coordinate } mode = Mode::search;
+	int first_arg = 1;
+	if (argc > 1 && std::string(argv[1]) == "index") { mode = Mode::index; first_arg = 2; }
+	else if (argc > 1 && std::string(argv[1]) == "query") { mode = Mode::query; first_arg = 2; }
 
 	// --- Parse command line ---
-	for (int i = 1; i < argc; ++i) {
+	for (int i = first_arg; i < argc; ++i) {
 		std::string arg(argv[i]);
-		if (arg == "--shuffle") shuffle = true;
-		else if (arg == "--sort") sort_result = true;
-		else if (arg == "--printline") print_line = true;
-		else if (arg == "--printpath") print_path = true;
+		if (arg == "--shuffle") query.shuffle = true;
+		else if (arg == "--largest-first") query.largest_first = true;
+		else if (arg == "--sort" || arg == "--sort=path") ot.sort = OutThread::Sort::path;
+		else if (arg == "--sort=hits") ot.sort = OutThread::Sort::hits;
+		else if (arg == "--printline") ot.print_line = true;
+		else if (arg == "--printpath") ot.print_path = true;
+		else if (arg == "-A" && i + 1 < argc) query.after_context = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "-B" && i + 1 < argc) query.before_context = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "-C" && i + 1 < argc) query.before_context = query.after_context = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--cache") options.use_cache = true;
+		else if (arg == "--stats") print_stats = true;
+		else if (arg == "--stats-json" && i + 1 < argc) stats_json = argv[++i];
+		else if (arg == "--cache-dir" && i + 1 < argc) { options.use_cache = true; options.cache_dir = argv[++i]; }
+		else if (arg == "-f" && i + 1 < argc) pattern_file = argv[++i];
+		else if (arg == "--serve" && mode == Mode::search) mode = Mode::serve;
+		else if (arg == "--client" && mode == Mode::search) mode = Mode::client;
+		else if (arg == "--socket" && i + 1 < argc) socket_path = argv[++i];
+		else if (arg == "--listen" && i + 1 < argc) listen_address = argv[++i];
+		else if (arg == "--workers" && i + 1 < argc && mode == Mode::search) { mode = Mode::coordinate; workers = argv[++i]; }
+		else if (arg == "--token" && i + 1 < argc) token = argv[++i];
+		else if ((arg == "-e" || arg == "--regex") && i + 1 < argc) { query.regex = true; query.patterns.push_back(argv[++i]); }
+		else if (arg == "--mmap") options.use_mmap = true;
+		else if (arg == "--pin") options.pin = true;
+		else if (arg == "--normalize") query.normalize = true;
+		else if (arg == "--join-lines") query.join_lines = true;
+		else if (arg == "--fps" && i + 1 < argc) ot.fps = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--stream") { if (ot.format == OutThread::Format::terminal) ot.format = OutThread::Format::text; }
+		else if (arg == "--json") ot.format = OutThread::Format::json;
+		else if (arg == "--ndjson") ot.format = OutThread::Format::ndjson;
+		else if (arg == "-l" || arg == "--files-with-matches") { ot.files_only = true; query.max_count = 1; }
+		else if ((arg == "-m" || arg == "--max-count") && i + 1 < argc) query.max_count = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--file-timeout" && i + 1 < argc) options.file_timeout = std::max(0.0, std::atof(argv[++i]));
+		else if (arg == "--max-pages" && i + 1 < argc) options.max_pages = std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--region" && i + 1 < argc) region = argv[++i];
+		else if (arg == "--max-line" && i + 1 < argc) query.max_line = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--sort-memory" && i + 1 < argc) ot.held.budget = size_t(std::max(0, std::atoi(argv[++i]))) << 20;
+		else if (arg == "--limit" && i + 1 < argc) query.limit = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--top" && i + 1 < argc) query.top = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--rank" && i + 1 < argc) rank = argv[++i];
+		else if (arg == "--walkers" && i + 1 < argc) options.walk_threads = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+		else if (arg == "-j" && i + 1 < argc) options.threads = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--readers" && i + 1 < argc) options.readers = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--matchers" && i + 1 < argc) options.matchers = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--read-queue" && i + 1 < argc) options.read_queue_depth = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--match-queue" && i + 1 < argc) options.match_queue_depth = std::strtoul(argv[++i], nullptr, 10);
 		else if (directory.empty()) directory = arg;
-		else if (sf.searchWord.empty()) sf.searchWord = arg;
+		else query.patterns.push_back(arg);
+	}
+
+	if (!pattern_file.empty()) {
+		std::ifstream in(pattern_file);
+		if (!in) {
+			std::cout << "Can't read pattern file " << pattern_file << "\n";
+			return 1;
+		}
+		std::string line;
+		while (std::getline(in, line)) {
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			if (!line.empty()) query.patterns.push_back(line);
+		}
 	}
 
-	if (sf.searchWord.empty()) {
-		if (!directory.empty()) {
-			std::swap(directory, sf.searchWord);
+	if (query.patterns.empty() && mode != Mode::index && mode != Mode::serve) {
+		if (!directory.empty() && pattern_file.empty()) {
+			query.patterns.push_back(directory);
+			directory.clear();
 		} else {
-			std::cout << "Usage: " << argv[0] << " [<directory>] <search-string> [--shuffle] [--sort] [--printline] [--printpath]\n";
+			std::cout << "Usage: " << argv[0] << " [<directory>] <search-string>... [-f <pattern-file>] [-e <regex>] [--normalize] [--join-lines] [--shuffle] [--largest-first] [--sort[=path|hits]] [--printline] [--printpath] [-A|-B|-C <lines>] [--cache] [--cache-dir <dir>]\n"
+					  << "         [--stats] [--stats-json <file>] [-j <extract-threads>] [--readers <n>] [--matchers <n>] [--read-queue <files>] [--match-queue <pages>] [--mmap] [--pin] [--walkers <n>] [--fps <n>]\n"
+					  << "         [--stream] [--json] [--ndjson] [-l] [-m <count>] [--limit <files>] [--file-timeout <seconds>] [--max-pages <n>]\n"
+					  << "         [--max-line <bytes>] [--sort-memory <MB>] [--region <x,y,w,h>] [--top <k> [--rank hits|density]]\n"
+					  << "       " << argv[0] << " index [<directory>] [--cache-dir <dir>]\n"
+					  << "       " << argv[0] << " query [<directory>] <search-string>... [-f <pattern-file>] [--cache-dir <dir>] [--top <k> [--rank hits|density|bm25]]\n"
+					  << "       " << argv[0] << " --serve [<directory>] [--socket <path>] [--cache] [--cache-dir <dir>] [-j <extract-threads>] ...\n"
+					  << "       " << argv[0] << " --client [<directory>] <search-string>... [--socket <path>] [-e <regex>] [--join-lines] [--sort[=path|hits]] [--json] [--ndjson] [-l] [-m <count>] [--limit <files>] [--max-line <bytes>]\n"
+					  << "         [--printline] [--printpath] [-A|-B|-C <lines>] [--region <x,y,w,h>] [--top <k> [--rank hits|density]]\n"
+					  << "       " << argv[0] << " --serve [<directory>] --listen <host:port> --token <secret> ...\n"
+					  << "       " << argv[0] << " --workers <host:port,...> [<directory>] <search-string>... [--token <secret>] [the --client options]\n";
 			return 1;
 		}
 	}
 
-	fs::path dir = directory.empty() ? fs::current_path() : fs::path(directory);
-	sf.pdfFileNames = pdf::get_pdf_files(dir, shuffle);
+	if (rank == "hits") query.rank = Rank::hits;
+	else if (rank == "density") query.rank = Rank::density;
+	else if (rank == "bm25") query.rank = Rank::bm25;
+	else {
+		std::cerr << "Invalid --rank " << rank << ", expected hits, density or bm25\n";
+		return 1;
+	}
+	// The top comes in its own order, written at the end
+	if (query.top)
+		ot.sort = OutThread::Sort::none;
+	// Redrawing only makes sense on a terminal, pipes and files get the results streamed.
+	// Sorted output is streamed too, results only appear once their position is final.
+	if (ot.format == OutThread::Format::terminal && (!terminal::is_terminal() || ot.sort != OutThread::Sort::none || query.top))
+		ot.format = OutThread::Format::text;
+	if (!region.empty() && !pdf::parse_region(region, query.region)) {
+		std::cerr << "Invalid --region " << region << ", expected x,y,width,height in points\n";
+		return 1;
+	}
+	// Context goes with the lines it surrounds, like grep
+	if (query.before_context || query.after_context)
+		ot.print_line = true;
+	// Path order is written while searching if files are searched in that order, which needs the whole list up front
+	query.path_order = ot.sort == OutThread::Sort::path;
+	// Streamed output stays machine readable, everything else goes to stderr
+	const bool live_display = ot.format == OutThread::Format::terminal;
+	std::ostream& info = live_display ? std::cout : std::cerr;
+
+	auto run_start = StatsClock::now();
+	query.directory = directory.empty() ? fs::current_path() : fs::path(directory);
+	if (socket_path.empty())
+		socket_path = SearchServer::default_socket();
 
-	sf.total_files = sf.pdfFileNames.size();
+	if (mode == Mode::client || mode == Mode::coordinate) { // the servers search their own file lists, nothing is walked here
+		ServeRequest req;
+		req.patterns = query.patterns;
+		// A worker's directory is one on its machine, without one it searches everything it serves
+		if (mode == Mode::client) req.directory = SearchServer::absolute_dir(query.directory);
+		else if (!directory.empty()) req.directory = fs::u8path(directory);
+		req.regex = query.regex;
+		req.normalize = query.normalize;
+		req.join_lines = query.join_lines;
+		req.max_count = query.max_count;
+		req.limit = query.limit;
+		req.top = query.top;
+		req.rank = query.rank;
+		req.max_line = query.max_line;
+		req.before_context = query.before_context;
+		req.after_context = query.after_context;
+		req.print_line = ot.print_line;
+		req.print_path = ot.print_path;
+		req.region = region;
+		req.format = ot.format == OutThread::Format::terminal ? OutThread::Format::text : ot.format; // no redraws over a socket
+		req.sort = ot.sort;
+		req.files_only = ot.files_only;
+		req.token = token;
+		if (mode == Mode::client)
+			return SearchServer::run_client(socket_path, req);
+		Coordinator coordinator(req, ot);
+		for (size_t start = 0, end; start < workers.size(); start = end + 1) {
+			end = std::min(workers.find(',', start), workers.size());
+			if (end > start) coordinator.addresses.push_back(workers.substr(start, end - start));
+		}
+		return coordinator.run(info);
+	}
+	const fs::path& dir = query.directory;
+	if (options.cache_dir.empty())
+		options.cache_dir = pdf::default_cache_dir();
+	if (mode != Mode::search) // the index verifies hits against cached text
+		options.use_cache = true;
+	if (mode == Mode::serve) // the text of every searched file stays in memory
+		options.memory_cache = true;
+	SearchEngine engine(options);
 
-	SearchThreads st(&sf);
-	OutThread ot(&sf);
-	
-	st.search();
+	if (mode == Mode::serve) {
+		SearchServer server(engine, query.directory, socket_path);
+		server.listen_address = listen_address;
+		server.token = token;
+		return server.run(info);
+	}
+
+	if (mode == Mode::index) {
+		auto files = pdf::get_pdf_files(dir, false, options.walk_threads);
+		fs::path index_path = PdfIndex::location(options.cache_dir, dir);
+		PdfIndexBuilder::Stats stats;
+		if (!PdfIndexBuilder::build(files, *engine.textCache(), index_path, stats)) {
+			std::cout << "Failed to write index " << index_path << "\n";
+			return 1;
+		}
+		std::cout << "indexed " << (stats.reused + stats.extracted) << " files (" << stats.reused << " unchanged, "
+				  << stats.extracted << " extracted), " << stats.terms << " terms\n" << index_path.string() << "\n";
+		if (stats.erroredPaths.size())
+			std::cout << "\nerroredPaths:\n";
+		for (auto& s : stats.erroredPaths)
+			std::cout << s << std::endl;
+		return 0;
+	}
+
+	if (mode == Mode::query) {
+		PdfIndex index;
+		if (!index.open(PdfIndex::location(options.cache_dir, dir))) {
+			std::cout << "No index for " << dir << ", run: " << argv[0] << " index " << dir << "\n";
+			return 1;
+		}
+		// Candidate pages of all patterns, per pattern for BM25
+		std::vector<Posting> hits, pattern_hits, merged;
+		std::vector<std::vector<Posting>> pattern_pages;
+		const bool scored = query.top && query.rank == Rank::bm25;
+		bool narrowed = !query.regex; // the index only knows literal tokens, regular expressions scan every file
+		const TextFolder index_folder(true, query.join_lines); // the pattern as the search folds it, the index knows joined words
+		for (const auto& w : query.patterns) {
+			if (!narrowed) break;
+			narrowed = index.candidates(index_folder.fold(w), pattern_hits);
+			merged.clear();
+			std::set_union(hits.begin(), hits.end(), pattern_hits.begin(), pattern_hits.end(), std::back_inserter(merged));
+			hits.swap(merged);
+			if (scored) pattern_pages.push_back(pattern_hits);
+		}
+		std::vector<double> scores; // without narrowing the search fails, bm25 needs the index
+		if (scored && narrowed)
+			scores = index.bm25(pattern_pages);
+		size_t h = 0;
+		for (uint32_t f = 0; f < index.fileCount(); ++f) {
+			std::vector<int> pages;
+			for (; h < hits.size() && hits[h].file == f; ++h)
+				pages.push_back(int(hits[h].page));
+
+			std::string_view path_u8 = index.filePath(f);
+			fs::path path = fs::u8path(path_u8.begin(), path_u8.end());
+			FileKey current;
+			if (!FileKey::fromPath(path, current))
+				continue; // deleted since indexing
+			// Files changed since indexing are scanned completely, the index can't vouch for them
+			bool changed = current != index.fileKey(f);
+			if (narrowed && !changed && pages.empty())
+				continue;
+			query.files.push_back(path);
+			query.candidate_pages.push_back(narrowed && !changed ? std::move(pages) : std::vector<int>());
+			if (!scores.empty()) query.file_scores.push_back(scores[f]);
+		}
+		query.walk = false;
+	}
+
+	std::string pattern_error;
+	auto search = engine.start(query, pattern_error);
+	if (!search) {
+		info << pattern_error << "\n";
+		return 1;
+	}
+	SearchedFiles& sf = search->files;
+	SearchThreads& st = search->threads;
+	ot.sf = &sf;
 	ot.print();
 	
 		//// --- Cleanup ---
-		sf.aborted = true;
-		sf.queue_cv.notify_all(); // Wake up all workers to see the aborted flag
-		for (auto& t : st.pool) t.join(); // Wait for all worker threads to finish
+		search->cancel(); // wakes up whatever still waits
+		search->wait(true); // Wait for all worker threads to finish, but not for Poppler to return from a timed out file
+		ot.finish();
 		
 		// --- Abort input thread ---
 		std::thread abort_thread([&]() {
@@ -60,65 +283,46 @@ int main(int argc, char* argv[]) {
 
 		//const bool debug_check = true;
 
-		std::cout << "completed!\n";
+		if (live_display)
+			std::cout << "completed!\n";
 		if (sf.erroredPaths.size())
-			std::cout << "\nerroredPaths:\n";
-		for (auto& s : sf.erroredPaths)
-			std::cout << s << std::endl;
+			info << "\nerroredPaths:\n";
+		for (size_t i = 0; i < sf.erroredPaths.size(); ++i)
+			info << sf.erroredPaths[i] << std::endl;
+		if (sf.fileErrors.size())
+			info << "\nfileErrors:\n";
+		for (size_t i = 0; i < sf.fileErrors.size(); ++i) {
+			const FileError& e = sf.fileErrors[i];
+			info << FileError::name(e.kind) << "\t" << e.path << (e.detail.empty() ? "" : "\t" + e.detail) << "\n";
+		}
+		if (sf.noTextPaths.size())
+			info << "\n" << sf.noTextPaths.size() << " files without text skipped\n";
 
-		//TODO fix for new mutex
-	#if 0
-		if (sort_result) {
-
-			//delete_last_lines(results.size() * 2); // Clear the remaining active lines
-			// Create a copy to sort, so original `results` order (by processing start time) is preserved if needed.
-			std::vector<std::shared_ptr<SearchResult>> resultsSorted = results;
-			//std::sort(
-			//	resultsSorted.begin(), 
-			//	resultsSorted.end(), 
-			//	[](const std::shared_ptr<SearchResult>& a, const std::shared_ptr<SearchResult>& b) {
-			//		return a->pdf_path < b->pdf_path;
-			//	}
-			//);
-
-			if (resultsSorted.empty()) {
-				std::cout << "No PDF files containing \"" << target << "\" found in " << dir << "\n";
-			} else {
-				std::cout << "\nFinal matching results (sorted):\n";
-				for (auto res : resultsSorted) {
-					// Only print if there were any occurrences found
-					if (!res->occurences.empty()) {
-						// Line 1: Filename and optional path
-						std::cout << res->pdf_path.filename().string();
-						if (print_path)
-							std::cout << "	" << res->pdf_path.parent_path();
-						std::cout << "\n";
-
-						// Line 2: Tab followed by pages (ensuring sorted and unique)
-						std::cout << "	";
-						std::vector<int> final_pages_for_output;
-						for(const auto& occ : res->occurences) {
-							final_pages_for_output.push_back(occ.page);
-						}
-						std::sort(final_pages_for_output.begin(), final_pages_for_output.end());
-						final_pages_for_output.erase(std::unique(final_pages_for_output.begin(), final_pages_for_output.end()), final_pages_for_output.end());
-
-						for (size_t i = 0; i < final_pages_for_output.size(); ++i) {
-							if (i > 0) std::cout << ", ";
-							std::cout << final_pages_for_output[i];
-						}
-						std::cout << "\n";
-
-						// If print_line is requested, show full line details (these are separate, not part of the 2-line result)
-						if (print_line) {
-							for (const auto& occ : res->occurences) {
-								std::cout << "		Page " << occ.page << ", Line " << occ.line_number << ": " << occ.line << "\n";
-							}
-						}
-					}
-				}
+		if (print_stats || !stats_json.empty()) {
+			RunStats stats;
+			stats.wall_time = seconds_since(run_start);
+			stats.walk_time = search->walk_time;
+			stats.output_time = ot.busy_time;
+			stats.spilled_bytes = uint64_t(ot.held.spilled());
+			stats.collect(st.stats(), st.num_readers, st.num_threads);
+			for (size_t i = 0; i < sf.fileErrors.size(); ++i)
+				stats.timeouts += sf.fileErrors[i].kind == FileError::Kind::timeout;
+			if (print_stats)
+				stats.print(info);
+			if (stats_json == "-") {
+				stats.printJson(std::cout);
+			} else if (!stats_json.empty()) {
+				std::ofstream out(stats_json);
+				stats.printJson(out);
+				if (!out)
+					info << "Can't write stats to " << stats_json << "\n";
 			}
 		}
-	#endif
+		if (st.hung) { // destroying the search would wait for Poppler to return
+			std::cout.flush();
+			std::cerr.flush();
+			std::fflush(stdout);
+			std::_Exit(0);
+		}
 	return 0;
 }
\ No newline at end of file
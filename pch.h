@@ -1,9 +1,12 @@
 #include <string>
 #ifdef _WIN32
 #include <windows.h>
+#include <io.h>
 #elif defined(__linux__) || defined(__APPLE__)
 #include <sys/ioctl.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
 #endif
 
 #include <poppler-document.h>
@@ -14,11 +17,19 @@ namespace fs = std::filesystem;
 
 #include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
 
 // random
 #include <random>
 #include <cstdio>
+#include <cstring>
 #include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <climits>
+#include <csignal>
 
 #include <memory>
 #include <thread>
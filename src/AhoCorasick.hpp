@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Matcher.hpp"
+
+#include <queue>
+
+// Aho-Corasick automaton over ASCII case-folded bytes, matches all patterns in one pass.
+// Transitions are a dense DFA over byte classes: bytes not occurring in any pattern share one class,
+// which keeps the table small enough to stay in cache for a few hundred patterns.
+class AhoCorasickMatcher : public PageMatcher {
+	std::vector<size_t> lengths;         // per pattern
+	unsigned char byteClass[256];
+	int classCount = 1;                  // class 0: bytes that don't occur in any pattern
+	std::vector<int32_t> delta;          // state * classCount + class -> state
+	std::vector<int32_t> outStart;       // per state, range into outPatterns (states + 1 entries)
+	std::vector<int32_t> outPatterns;    // patterns ending in a state, including those reached by suffix links
+
+	static unsigned char fold(unsigned char c) { return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c; }
+
+public:
+	explicit AhoCorasickMatcher(const std::vector<std::string>& patternsLower) {
+		std::fill(std::begin(byteClass), std::end(byteClass), 0);
+		for (const auto& p : patternsLower)
+			for (unsigned char c : p)
+				if (!byteClass[fold(c)]) byteClass[fold(c)] = (unsigned char)classCount++;
+		for (int c = 'A'; c <= 'Z'; ++c)
+			byteClass[c] = byteClass[c + 32];
+
+		// --- Trie ---
+		std::vector<std::vector<int32_t>> go(1, std::vector<int32_t>(classCount, -1));
+		std::vector<std::vector<int32_t>> out(1);
+		for (size_t p = 0; p < patternsLower.size(); ++p) {
+			lengths.push_back(patternsLower[p].size());
+			if (patternsLower[p].empty()) continue;
+			int32_t s = 0;
+			for (unsigned char c : patternsLower[p]) {
+				int cls = byteClass[c];
+				if (go[s][cls] < 0) {
+					go[s][cls] = (int32_t)go.size();
+					go.emplace_back(classCount, -1);
+					out.emplace_back();
+				}
+				s = go[s][cls];
+			}
+			out[s].push_back((int32_t)p);
+		}
+
+		// --- Failure links, folded into a complete transition table (BFS order) ---
+		std::vector<int32_t> fail(go.size(), 0);
+		std::queue<int32_t> q;
+		for (int c = 0; c < classCount; ++c) {
+			if (go[0][c] < 0) go[0][c] = 0;
+			else { fail[go[0][c]] = 0; q.push(go[0][c]); }
+		}
+		while (!q.empty()) {
+			int32_t s = q.front(); q.pop();
+			out[s].insert(out[s].end(), out[fail[s]].begin(), out[fail[s]].end());
+			for (int c = 0; c < classCount; ++c) {
+				int32_t t = go[s][c];
+				if (t < 0) {
+					go[s][c] = go[fail[s]][c];
+				} else {
+					fail[t] = go[fail[s]][c];
+					q.push(t);
+				}
+			}
+		}
+
+		delta.reserve(go.size() * classCount);
+		outStart.reserve(go.size() + 1);
+		for (size_t s = 0; s < go.size(); ++s) {
+			delta.insert(delta.end(), go[s].begin(), go[s].end());
+			outStart.push_back((int32_t)outPatterns.size());
+			outPatterns.insert(outPatterns.end(), out[s].begin(), out[s].end());
+		}
+		outStart.push_back((int32_t)outPatterns.size());
+	}
+
+	size_t patternCount() const override { return lengths.size(); }
+
+	// Hits are reported in order of their end offset
+	void scan(std::string_view text, const HitFunc& hit) const override {
+		int32_t s = 0;
+		for (size_t i = 0; i < text.size(); ++i) {
+			s = delta[size_t(s) * classCount + byteClass[(unsigned char)text[i]]];
+			for (int32_t o = outStart[s]; o < outStart[s + 1]; ++o) {
+				int32_t p = outPatterns[o];
+				size_t next = hit(i + 1 - lengths[p], lengths[p], p);
+				if (next > i + 1) {
+					// Restart the automaton behind the skipped region
+					i = next - 1;
+					s = 0;
+					break;
+				}
+			}
+		}
+	}
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <new>
+
+// Append-only list that readers access without locks while writers append.
+// Elements never move: storage grows by chunks of doubling size that are never reallocated, and size()
+// is published with release semantics after the element was constructed, so everything below size() is
+// safe to read. Appends are serialized by a writer-side mutex that readers never touch.
+template<typename T>
+class AppendList {
+	static constexpr size_t first_chunk = 16;
+	static constexpr int max_chunks = 40;
+
+	T* chunks[max_chunks] = {};
+	std::atomic<size_t> count{ 0 };
+	std::mutex write_mtx;
+
+	// Chunk c holds first_chunk << c elements starting at first_chunk * (2^c - 1)
+	static void locate(size_t i, int& chunk, size_t& offset) {
+		size_t n = i / first_chunk + 1;
+		chunk = 0;
+		while (n >>= 1) chunk++;
+		offset = i - first_chunk * ((size_t(1) << chunk) - 1);
+	}
+
+public:
+	AppendList() = default;
+	AppendList(const AppendList&) = delete;
+	AppendList& operator=(const AppendList&) = delete;
+
+	~AppendList() {
+		size_t n = count.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < n; ++i)
+			(*this)[i].~T();
+		for (T* c : chunks)
+			::operator delete(c);
+	}
+
+	// Returns the index of the new element
+	size_t push_back(T value) {
+		std::lock_guard<std::mutex> lock(write_mtx);
+		size_t i = count.load(std::memory_order_relaxed);
+		int c;
+		size_t offset;
+		locate(i, c, offset);
+		if (!chunks[c])
+			chunks[c] = static_cast<T*>(::operator new(sizeof(T) * (first_chunk << c)));
+		new (chunks[c] + offset) T(std::move(value));
+		count.store(i + 1, std::memory_order_release);
+		return i;
+	}
+
+	size_t size() const { return count.load(std::memory_order_acquire); }
+	bool empty() const { return size() == 0; }
+
+	// i must be below a size() this thread has seen
+	const T& operator[](size_t i) const {
+		int c;
+		size_t offset;
+		locate(i, c, offset);
+		return chunks[c][offset];
+	}
+	T& operator[](size_t i) {
+		int c;
+		size_t offset;
+		locate(i, c, offset);
+		return chunks[c][offset];
+	}
+};
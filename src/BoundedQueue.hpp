@@ -0,0 +1,66 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// Blocking multi-producer multi-consumer queue with a fixed capacity, connects the pipeline stages.
+// Producers block while it is full, so a slow stage throttles the ones feeding it.
+template<typename T>
+class BoundedQueue {
+	std::mutex mtx;
+	std::condition_variable not_empty, not_full;
+	std::deque<T> items;
+	size_t capacity;
+	bool closed = false;
+
+public:
+	explicit BoundedQueue(size_t capacity) : capacity(std::max<size_t>(1, capacity)) {}
+
+	// Returns false if the queue was closed
+	bool push(T item) {
+		std::unique_lock<std::mutex> lock(mtx);
+		not_full.wait(lock, [&]() { return closed || items.size() < capacity; });
+		if (closed) return false;
+		items.push_back(std::move(item));
+		not_empty.notify_one();
+		return true;
+	}
+
+	// Returns false once the queue is closed and drained
+	bool pop(T& item) {
+		std::unique_lock<std::mutex> lock(mtx);
+		not_empty.wait(lock, [&]() { return closed || !items.empty(); });
+		return take(item);
+	}
+
+	// Like pop, but gives up after timeout. drained tells whether the queue is closed and empty.
+	bool pop_for(T& item, std::chrono::milliseconds timeout, bool& drained) {
+		std::unique_lock<std::mutex> lock(mtx);
+		not_empty.wait_for(lock, timeout, [&]() { return closed || !items.empty(); });
+		drained = closed && items.empty();
+		return take(item);
+	}
+
+	void close() {
+		std::lock_guard<std::mutex> lock(mtx);
+		closed = true;
+		not_empty.notify_all();
+		not_full.notify_all();
+	}
+
+	size_t size() {
+		std::lock_guard<std::mutex> lock(mtx);
+		return items.size();
+	}
+
+private:
+	bool take(T& item) {
+		if (items.empty()) return false;
+		item = std::move(items.front());
+		items.pop_front();
+		not_full.notify_one();
+		return true;
+	}
+};
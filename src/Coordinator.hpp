@@ -0,0 +1,206 @@
+#pragma once
+
+#include "SearchServer.hpp"
+#include "BoundedQueue.hpp"
+
+// pdfms --workers host:port,...: one search over shards on other machines. Every worker is a
+// pdfms --serve --listen next to its files, so extraction runs where the data is and only the hits cross the
+// network. Workers get the request as a ServeRequest and stream NDJSON records. The coordinator turns the records
+// of each file back into a completed SearchResult in its own SearchedFiles, so the OutThread prints them with the
+// formats and sorts of a local search. With --sort the workers send their files in path order and the streams are
+// merged, so the output is still written while the workers search.
+class Coordinator {
+	struct RemoteOccurrence {
+		int page;
+		int line_number;
+		int pattern;
+		std::string line, before, after; // context stored like SearchResult keeps it
+	};
+
+	struct RemoteFile {
+		fs::path path;
+		std::vector<RemoteOccurrence> occurrences;
+	};
+
+	struct Worker {
+		std::string address;
+		int fd = -1;
+		std::string buffer; // records read with the status line
+		std::thread thread;
+		BoundedQueue<std::unique_ptr<RemoteFile>> files{ 64 }; // --sort: waiting for the merge
+		std::string error;
+	};
+
+	const ServeRequest& request;
+	OutThread& ot;
+	SearchedFiles sf;
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::map<std::string, int> pattern_index;
+	const bool merging; // path order
+	std::mutex publish_mtx;
+
+	// Makes a file one more completed result of the search, returns false once --limit is reached
+	bool publish(const RemoteFile& file) {
+		std::lock_guard<std::mutex> lock(publish_mtx);
+		if (sf.aborted)
+			return false;
+		if (request.limit && sf.matched_files >= request.limit) {
+			sf.aborted = true; // enough, the readers stop
+			return false;
+		}
+		auto res = std::make_shared<SearchResult>(file.path, sf.total_files.load(), request.before_context || request.after_context);
+		for (const auto& o : file.occurrences)
+			res->addOccurrence(o.page, o.line_number, o.line, o.pattern, o.before, o.after);
+		// Every worker sends its own top, the best of those are the best overall
+		bool dropped = sf.top && !sf.top->offer(double(res->occurrenceCount()), res);
+		res->complete(dropped);
+		sf.results.push_back(std::move(res));
+		sf.total_files++;
+		sf.completed_files++;
+		sf.matched_files++;
+		sf.notifyUpdate();
+		return true;
+	}
+
+	bool parse(const std::map<std::string, json::Value>& fields, RemoteOccurrence& o) {
+		auto file = fields.find("file"), page = fields.find("page"), line_number = fields.find("line_number"), line = fields.find("line");
+		if (file == fields.end() || page == fields.end() || line_number == fields.end() || line == fields.end())
+			return false;
+		o.page = std::atoi(page->second.text.c_str());
+		o.line_number = std::atoi(line_number->second.text.c_str());
+		o.line = line->second.text;
+		auto pattern = fields.find("pattern");
+		auto p = pattern == fields.end() ? pattern_index.end() : pattern_index.find(pattern->second.text);
+		o.pattern = p == pattern_index.end() ? 0 : p->second;
+		o.before.clear();
+		o.after.clear();
+		if (auto before = fields.find("before"); before != fields.end())
+			for (const auto& l : before->second.items) o.before += l + "\n";
+		if (auto after = fields.find("after"); after != fields.end())
+			for (const auto& l : after->second.items) o.after += "\n" + l;
+		return true;
+	}
+
+	// Groups the records of a worker by file, the records of one file arrive together
+	void read(Worker& w) {
+		std::string& buffer = w.buffer;
+		std::string line;
+		std::map<std::string, json::Value> fields;
+		std::unique_ptr<RemoteFile> file;
+		auto deliver = [&]() {
+			if (merging) w.files.push(std::move(file));
+			else publish(*file);
+			file.reset();
+		};
+		while (!sf.aborted && net::read_line(w.fd, buffer, line)) {
+			RemoteOccurrence o;
+			if (!json::parse_object(line, fields) || !parse(fields, o)) {
+				w.error = "malformed record: " + line.substr(0, 80);
+				break;
+			}
+			fs::path path = fs::u8path(fields["file"].text);
+			if (file && file->path != path)
+				deliver();
+			if (!file) {
+				file = std::make_unique<RemoteFile>();
+				file->path = std::move(path);
+			}
+			file->occurrences.push_back(std::move(o));
+		}
+		if (file && w.error.empty())
+			deliver();
+		w.files.close();
+	}
+
+	// Path order: the smallest path at the heads of the streams is next, a worker that has nothing yet is waited for
+	void merge() {
+		std::vector<std::unique_ptr<RemoteFile>> heads(workers.size());
+		for (size_t k = 0; k < workers.size(); ++k)
+			workers[k]->files.pop(heads[k]);
+		while (true) {
+			size_t next = heads.size();
+			for (size_t k = 0; k < heads.size(); ++k)
+				if (heads[k] && (next == heads.size() || heads[k]->path < heads[next]->path))
+					next = k;
+			if (next == heads.size() || !publish(*heads[next]))
+				break;
+			heads[next].reset();
+			workers[next]->files.pop(heads[next]);
+		}
+		for (auto& w : workers) // unblocks readers still pushing after an abort
+			w->files.close();
+	}
+
+	void stop() {
+		sf.aborted = true;
+		sf.queue_cv.notify_all();
+		for (auto& w : workers) {
+			net::shutdown(w->fd);
+			w->files.close();
+		}
+	}
+
+public:
+	std::vector<std::string> addresses; // host:port of the workers
+
+	Coordinator(const ServeRequest& request, OutThread& ot) : request(request), ot(ot), merging(request.sort == OutThread::Sort::path) {}
+
+	// Runs the search on every worker and prints the results, returns the exit code
+	int run(std::ostream& info) {
+	#ifdef _WIN32
+		info << "--workers needs sockets, which this build doesn't support\n";
+		return 1;
+	#else
+		std::signal(SIGPIPE, SIG_IGN);
+		if (request.top && request.rank != Rank::hits) {
+			info << "--rank " << (request.rank == Rank::bm25 ? "bm25" : "density") << " isn't supported with --workers, the records don't carry it\n";
+			return 1;
+		}
+		if (request.top)
+			sf.top = std::make_unique<TopK>(request.top, Rank::hits);
+		sf.searchWords = request.patterns;
+		for (size_t i = 0; i < request.patterns.size(); ++i)
+			pattern_index.emplace(request.patterns[i], int(i));
+		sf.walk_done = false; // until every worker finished
+		ServeRequest remote = request;
+		remote.format = OutThread::Format::ndjson;
+		remote.sort = merging ? OutThread::Sort::path : OutThread::Sort::none; // hits are ranked here
+
+		int failed = 0;
+		for (const auto& address : addresses) {
+			auto w = std::make_unique<Worker>();
+			w->address = address;
+			w->fd = net::connect_tcp(address);
+			std::string error;
+			if (w->fd < 0 || !SearchServer::send_request(w->fd, remote, w->buffer, error)) {
+				info << address << ": " << (w->fd < 0 ? "can't connect" : error) << "\n";
+				if (w->fd >= 0) net::close(w->fd);
+				failed++;
+				continue;
+			}
+			w->thread = std::thread([this, wp = w.get()]() { read(*wp); });
+			workers.push_back(std::move(w));
+		}
+		std::thread collector([this]() {
+			if (merging) merge();
+			for (auto& w : workers) w->thread.join();
+			sf.finishWalk();
+		});
+
+		ot.sf = &sf;
+		ot.print();
+		if (sf.aborted) // output failed or --limit reached
+			stop();
+		collector.join();
+		ot.finish();
+		for (auto& w : workers) {
+			if (!w->error.empty()) {
+				info << w->address << ": " << w->error << "\n";
+				failed++;
+			}
+			net::close(w->fd);
+		}
+		return failed ? 1 : 0;
+	#endif
+	}
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+// Parallel recursive directory walk that hands PDF paths to a callback as soon as a directory is listed.
+// Every directory is a task, idle threads pick up the subdirectories found by others.
+// Entry types come from readdir's d_type (FindFirstFileEx attributes on Windows) so regular entries need no stat.
+// Like fs::recursive_directory_iterator, symlinked directories are not followed and unreadable ones are skipped.
+class DirectoryCrawler {
+public:
+	// Receives the PDFs of one directory, called concurrently from the crawler threads
+	using FilesFunc = std::function<void(std::vector<fs::path>&)>;
+
+	// The names the walk reports, also used to filter file system notifications
+	static bool is_pdf_name(const char* name, size_t len) {
+		return len > 4 && std::memcmp(name + len - 4, ".pdf", 4) == 0;
+	}
+
+private:
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::vector<fs::path> dirs;
+	size_t busy = 0; // threads listing a directory, which may still add subdirectories
+	const FilesFunc& on_files;
+	const std::atomic<bool>* aborted;
+
+	DirectoryCrawler(const FilesFunc& on_files, const std::atomic<bool>* aborted) : on_files(on_files), aborted(aborted) {}
+
+	static void list(const fs::path& dir, std::vector<fs::path>& subdirs, std::vector<fs::path>& files) {
+	#ifdef _WIN32
+		WIN32_FIND_DATAW data;
+		HANDLE h = FindFirstFileExW((dir / L"*").c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+		if (h == INVALID_HANDLE_VALUE) return;
+		do {
+			const wchar_t* name = data.cFileName;
+			size_t len = wcslen(name);
+			if ((len == 1 && name[0] == L'.') || (len == 2 && name[0] == L'.' && name[1] == L'.')) continue;
+			if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+				if (!(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+					subdirs.push_back(dir / name);
+			} else if (len > 4 && wcscmp(name + len - 4, L".pdf") == 0) {
+				files.push_back(dir / name);
+			}
+		} while (FindNextFileW(h, &data));
+		FindClose(h);
+	#else
+		DIR* d = opendir(dir.c_str());
+		if (!d) return;
+		while (dirent* e = readdir(d)) {
+			const char* name = e->d_name;
+			if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+			size_t len = std::strlen(name);
+			bool pdf_name = is_pdf_name(name, len);
+			unsigned char type = e->d_type;
+
+			if (type == DT_UNKNOWN || (type == DT_LNK && pdf_name)) {
+				// Filesystems without d_type and symlinks to PDFs need a stat
+				struct stat st;
+				fs::path full = dir / name;
+				if (lstat(full.c_str(), &st) != 0) continue;
+				if (S_ISLNK(st.st_mode)) {
+					// Links to PDFs count like with is_regular_file(), linked directories aren't followed
+					if (!pdf_name || stat(full.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+					type = DT_REG;
+				} else {
+					type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+				}
+			}
+			if (type == DT_DIR)
+				subdirs.push_back(dir / name);
+			else if (type == DT_REG && pdf_name)
+				files.push_back(dir / name);
+		}
+		closedir(d);
+	#endif
+	}
+
+	void worker() {
+		std::vector<fs::path> subdirs, files;
+		while (true) {
+			fs::path dir;
+			{
+				std::unique_lock<std::mutex> lock(mtx);
+				cv.wait(lock, [&]() { return !dirs.empty() || busy == 0; });
+				if (dirs.empty() || (aborted && *aborted))
+					break; // nothing queued and nobody left who could queue more
+				dir = std::move(dirs.back());
+				dirs.pop_back();
+				busy++;
+			}
+
+			subdirs.clear();
+			files.clear();
+			list(dir, subdirs, files);
+			if (!files.empty())
+				on_files(files);
+
+			std::lock_guard<std::mutex> lock(mtx);
+			for (auto& s : subdirs)
+				dirs.push_back(std::move(s));
+			busy--;
+			cv.notify_all();
+		}
+		std::lock_guard<std::mutex> lock(mtx);
+		dirs.clear(); // release the others after an abort
+		cv.notify_all();
+	}
+
+public:
+	// Walks root with num_threads threads and returns when the whole tree was listed
+	static void crawl(const fs::path& root, size_t num_threads, const FilesFunc& on_files, const std::atomic<bool>* aborted = nullptr) {
+		std::error_code ec;
+		if (!fs::is_directory(root, ec))
+			return;
+		DirectoryCrawler crawler(on_files, aborted);
+		crawler.dirs.push_back(root);
+		std::vector<std::thread> pool;
+		for (size_t i = 1; i < std::max<size_t>(1, num_threads); ++i)
+			pool.emplace_back([&]() { crawler.worker(); });
+		crawler.worker();
+		for (auto& t : pool) t.join();
+	}
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "MappedFile.hpp"
+
+#include <mutex>
+
+// Recycles read buffers between files and page text buffers between pages, so the steady state doesn't allocate
+template<typename Buffer = std::vector<char>>
+class BufferPool {
+	std::mutex mtx;
+	std::vector<Buffer> free;
+	size_t max_buffers;
+	size_t max_bytes; // larger buffers aren't kept around
+
+public:
+	BufferPool(size_t max_buffers = 8, size_t max_bytes = size_t(64) << 20) : max_buffers(max_buffers), max_bytes(max_bytes) {}
+
+	void setMaxBuffers(size_t n) { max_buffers = n; }
+
+	Buffer acquire(size_t size) {
+		Buffer buffer;
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			// Best fit among the free buffers
+			size_t best = free.size();
+			for (size_t i = 0; i < free.size(); ++i)
+				if (free[i].capacity() >= size && (best == free.size() || free[i].capacity() < free[best].capacity()))
+					best = i;
+			if (best == free.size() && !free.empty())
+				best = 0; // grow one instead of allocating another
+			if (best < free.size()) {
+				buffer = std::move(free[best]);
+				free.erase(free.begin() + best);
+			}
+		}
+		buffer.resize(size);
+		return buffer;
+	}
+
+	void release(Buffer&& buffer) {
+		if (buffer.capacity() == 0 || buffer.capacity() > max_bytes)
+			return;
+		std::lock_guard<std::mutex> lock(mtx);
+		if (free.size() < max_buffers)
+			free.push_back(std::move(buffer));
+	}
+};
+
+// Bytes of a whole PDF in memory, either a read-only mapping or a pooled buffer filled with one large read,
+// handed to Poppler without copying.
+// A mapped file that is truncated while being searched may raise SIGBUS, reading into a buffer is immune to that.
+class FileData {
+	MappedFile mapping;
+	std::vector<char> buffer;
+	BufferPool<>* pool = nullptr;
+
+public:
+	FileData() = default;
+	FileData(const FileData&) = delete;
+	FileData& operator=(const FileData&) = delete;
+	~FileData() { clear(); }
+
+	// Files too large for load_from_raw_data stay empty, Poppler then reads them itself
+
+	bool map(const fs::path& path) {
+		clear();
+		std::error_code ec;
+		if (fs::file_size(path, ec) > uintmax_t(INT_MAX) && !ec) return true;
+		if (!mapping.open(path)) return false;
+		mapping.adviseWillNeed();
+		return true;
+	}
+
+	bool read(const fs::path& path, BufferPool<>& from) {
+		clear();
+		pool = &from;
+		std::error_code ec;
+		uintmax_t size = fs::file_size(path, ec);
+		if (ec) return false;
+		if (size > uintmax_t(INT_MAX)) return true;
+		buffer = pool->acquire(size_t(size));
+		return pdf::read_file_into(path, buffer.data(), buffer.size());
+	}
+
+	void clear() {
+		mapping.close();
+		if (pool) pool->release(std::move(buffer));
+		buffer = std::vector<char>();
+		pool = nullptr;
+	}
+
+	const char* data() const { return mapping.isOpen() ? mapping.data() : buffer.data(); }
+	size_t size() const { return mapping.isOpen() ? mapping.size() : buffer.size(); }
+	bool empty() const { return size() == 0; }
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "DirectoryCrawler.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#endif
+
+#include <unordered_map>
+
+// Reports PDFs that appear, change or disappear below a directory, for a server that keeps its file list.
+// Linux uses inotify with one watch per directory, directories created later are watched as they appear.
+// Elsewhere, or when inotify runs out of watches, the tree is walked again every poll_interval and the
+// listener is asked to compare (Change::rescan).
+class FileWatcher {
+public:
+	enum class Change {
+		updated, // created, written or moved in
+		removed, // deleted or moved away, for a directory everything below it
+		rescan,  // events were lost or can't be watched, the listener has to compare with a fresh walk
+	};
+	using ChangeFunc = std::function<void(const fs::path&, Change)>;
+
+	static constexpr std::chrono::seconds poll_interval{ 5 };
+
+private:
+	fs::path root;
+	ChangeFunc on_change;
+	std::atomic<bool> stopping{ false };
+	std::thread thread;
+
+#ifdef __linux__
+	int fd = -1;
+	std::unordered_map<int, fs::path> watched; // watch descriptor -> directory
+
+	static constexpr uint32_t mask = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF;
+
+	// Watches dir and everything below it. Returns false if inotify refused a watch.
+	bool watch_tree(const fs::path& dir) {
+		int wd = inotify_add_watch(fd, dir.c_str(), mask | IN_ONLYDIR | IN_DONT_FOLLOW);
+		if (wd < 0) return false;
+		watched[wd] = dir;
+		std::error_code ec;
+		for (fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end; !ec && it != end; it.increment(ec)) {
+			if (!it->is_directory(ec) || it->is_symlink(ec)) continue;
+			wd = inotify_add_watch(fd, it->path().c_str(), mask | IN_ONLYDIR | IN_DONT_FOLLOW);
+			if (wd < 0) return false;
+			watched[wd] = it->path();
+		}
+		return true;
+	}
+
+	// Files created in a new directory before its watch existed are only found by listing it
+	void report_tree(const fs::path& dir) {
+		DirectoryCrawler::crawl(dir, 1, [&](std::vector<fs::path>& files) {
+			for (const auto& f : files) on_change(f, Change::updated);
+		});
+	}
+
+	// Returns false if watching has to fall back to polling
+	bool handle(const inotify_event& e) {
+		if (e.mask & IN_Q_OVERFLOW) {
+			on_change(root, Change::rescan);
+			return true;
+		}
+		auto it = watched.find(e.wd);
+		if (it == watched.end()) return true;
+		if (e.mask & IN_IGNORED) { // watch removed, the directory is gone
+			watched.erase(it);
+			return true;
+		}
+		if (e.len == 0) return true; // about the directory itself, its parent reports it
+		fs::path path = it->second / e.name;
+		if (e.mask & IN_ISDIR) {
+			if (e.mask & (IN_CREATE | IN_MOVED_TO)) {
+				if (!watch_tree(path)) return false;
+				report_tree(path);
+			} else if (e.mask & (IN_DELETE | IN_MOVED_FROM)) {
+				on_change(path, Change::removed);
+			}
+			return true;
+		}
+		if (!DirectoryCrawler::is_pdf_name(e.name, std::strlen(e.name)))
+			return true;
+		if (e.mask & (IN_DELETE | IN_MOVED_FROM))
+			on_change(path, Change::removed);
+		else if (e.mask & (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO))
+			on_change(path, Change::updated);
+		return true;
+	}
+
+	// Returns when stopped, or false if it has to fall back to polling
+	bool watch() {
+		fd = inotify_init1(IN_CLOEXEC);
+		if (fd < 0) return false;
+		bool ok = watch_tree(root);
+		alignas(inotify_event) char buf[64 * 1024];
+		while (ok && !stopping) {
+			pollfd p{ fd, POLLIN, 0 };
+			int ready = ::poll(&p, 1, 200); // stop() is noticed within that time
+			if (ready < 0 && errno != EINTR) { ok = false; break; }
+			if (ready <= 0) continue;
+			ssize_t n = ::read(fd, buf, sizeof(buf));
+			if (n <= 0) continue;
+			for (char* e = buf; ok && e < buf + n; e += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(e)->len)
+				ok = handle(*reinterpret_cast<inotify_event*>(e));
+		}
+		::close(fd);
+		fd = -1;
+		watched.clear();
+		return ok;
+	}
+#else
+	bool watch() { return false; }
+#endif
+
+	void poll_tree() {
+		while (!stopping) {
+			auto next = std::chrono::steady_clock::now() + poll_interval;
+			while (!stopping && std::chrono::steady_clock::now() < next)
+				std::this_thread::sleep_for(std::chrono::milliseconds(200));
+			if (!stopping)
+				on_change(root, Change::rescan);
+		}
+	}
+
+public:
+	// on_change is called on the watcher thread
+	FileWatcher(const fs::path& root, ChangeFunc on_change) : root(root), on_change(std::move(on_change)) {}
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+	~FileWatcher() { stop(); }
+
+	void start() {
+		thread = std::thread([this]() {
+			if (watch() || stopping)
+				return;
+			on_change(root, Change::rescan); // changes may have been missed while setting up
+			poll_tree();
+		});
+	}
+
+	void stop() {
+		stopping = true;
+		if (thread.joinable()) thread.join();
+	}
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+// Generated by tools/gen_fold_tables.py from Unicode 14.0.0, do not edit.
+
+#include <cstdint>
+
+namespace fold_tables {
+	struct FoldRun {
+		uint32_t first, last; // code points first, first + stride, ... up to last
+		int stride;
+		int32_t delta; // added to the code point
+	};
+	struct FoldString {
+		uint32_t cp;
+		const char* utf8;
+	};
+
+	// Simple case folding (CaseFolding.txt status C and S)
+	inline constexpr FoldRun simple_runs[] = {
+		{ 0x0041, 0x005A, 1, 32 }, { 0x00B5, 0x00B5, 1, 775 }, { 0x00C0, 0x00D6, 1, 32 }, { 0x00D8, 0x00DE, 1, 32 },
+		{ 0x0100, 0x012E, 2, 1 }, { 0x0132, 0x0136, 2, 1 }, { 0x0139, 0x0147, 2, 1 }, { 0x014A, 0x0176, 2, 1 },
+		{ 0x0178, 0x0178, 1, -121 }, { 0x0179, 0x017D, 2, 1 }, { 0x017F, 0x017F, 1, -268 }, { 0x0181, 0x0181, 1, 210 },
+		{ 0x0182, 0x0184, 2, 1 }, { 0x0186, 0x0186, 1, 206 }, { 0x0187, 0x0187, 1, 1 }, { 0x0189, 0x018A, 1, 205 },
+		{ 0x018B, 0x018B, 1, 1 }, { 0x018E, 0x018E, 1, 79 }, { 0x018F, 0x018F, 1, 202 }, { 0x0190, 0x0190, 1, 203 },
+		{ 0x0191, 0x0191, 1, 1 }, { 0x0193, 0x0193, 1, 205 }, { 0x0194, 0x0194, 1, 207 }, { 0x0196, 0x0196, 1, 211 },
+		{ 0x0197, 0x0197, 1, 209 }, { 0x0198, 0x0198, 1, 1 }, { 0x019C, 0x019C, 1, 211 }, { 0x019D, 0x019D, 1, 213 },
+		{ 0x019F, 0x019F, 1, 214 }, { 0x01A0, 0x01A4, 2, 1 }, { 0x01A6, 0x01A6, 1, 218 }, { 0x01A7, 0x01A7, 1, 1 },
+		{ 0x01A9, 0x01A9, 1, 218 }, { 0x01AC, 0x01AC, 1, 1 }, { 0x01AE, 0x01AE, 1, 218 }, { 0x01AF, 0x01AF, 1, 1 },
+		{ 0x01B1, 0x01B2, 1, 217 }, { 0x01B3, 0x01B5, 2, 1 }, { 0x01B7, 0x01B7, 1, 219 }, { 0x01B8, 0x01B8, 1, 1 },
+		{ 0x01BC, 0x01BC, 1, 1 }, { 0x01C4, 0x01C4, 1, 2 }, { 0x01C5, 0x01C5, 1, 1 }, { 0x01C7, 0x01C7, 1, 2 },
+		{ 0x01C8, 0x01C8, 1, 1 }, { 0x01CA, 0x01CA, 1, 2 }, { 0x01CB, 0x01DB, 2, 1 }, { 0x01DE, 0x01EE, 2, 1 },
+		{ 0x01F1, 0x01F1, 1, 2 }, { 0x01F2, 0x01F4, 2, 1 }, { 0x01F6, 0x01F6, 1, -97 }, { 0x01F7, 0x01F7, 1, -56 },
+		{ 0x01F8, 0x021E, 2, 1 }, { 0x0220, 0x0220, 1, -130 }, { 0x0222, 0x0232, 2, 1 }, { 0x023A, 0x023A, 1, 10795 },
+		{ 0x023B, 0x023B, 1, 1 }, { 0x023D, 0x023D, 1, -163 }, { 0x023E, 0x023E, 1, 10792 }, { 0x0241, 0x0241, 1, 1 },
+		{ 0x0243, 0x0243, 1, -195 }, { 0x0244, 0x0244, 1, 69 }, { 0x0245, 0x0245, 1, 71 }, { 0x0246, 0x024E, 2, 1 },
+		{ 0x0345, 0x0345, 1, 116 }, { 0x0370, 0x0372, 2, 1 }, { 0x0376, 0x0376, 1, 1 }, { 0x037F, 0x037F, 1, 116 },
+		{ 0x0386, 0x0386, 1, 38 }, { 0x0388, 0x038A, 1, 37 }, { 0x038C, 0x038C, 1, 64 }, { 0x038E, 0x038F, 1, 63 },
+		{ 0x0391, 0x03A1, 1, 32 }, { 0x03A3, 0x03AB, 1, 32 }, { 0x03C2, 0x03C2, 1, 1 }, { 0x03CF, 0x03CF, 1, 8 },
+		{ 0x03D0, 0x03D0, 1, -30 }, { 0x03D1, 0x03D1, 1, -25 }, { 0x03D5, 0x03D5, 1, -15 }, { 0x03D6, 0x03D6, 1, -22 },
+		{ 0x03D8, 0x03EE, 2, 1 }, { 0x03F0, 0x03F0, 1, -54 }, { 0x03F1, 0x03F1, 1, -48 }, { 0x03F4, 0x03F4, 1, -60 },
+		{ 0x03F5, 0x03F5, 1, -64 }, { 0x03F7, 0x03F7, 1, 1 }, { 0x03F9, 0x03F9, 1, -7 }, { 0x03FA, 0x03FA, 1, 1 },
+		{ 0x03FD, 0x03FF, 1, -130 }, { 0x0400, 0x040F, 1, 80 }, { 0x0410, 0x042F, 1, 32 }, { 0x0460, 0x0480, 2, 1 },
+		{ 0x048A, 0x04BE, 2, 1 }, { 0x04C0, 0x04C0, 1, 15 }, { 0x04C1, 0x04CD, 2, 1 }, { 0x04D0, 0x052E, 2, 1 },
+		{ 0x0531, 0x0556, 1, 48 }, { 0x10A0, 0x10C5, 1, 7264 }, { 0x10C7, 0x10C7, 1, 7264 }, { 0x10CD, 0x10CD, 1, 7264 },
+		{ 0x13F8, 0x13FD, 1, -8 }, { 0x1C80, 0x1C80, 1, -6222 }, { 0x1C81, 0x1C81, 1, -6221 }, { 0x1C82, 0x1C82, 1, -6212 },
+		{ 0x1C83, 0x1C84, 1, -6210 }, { 0x1C85, 0x1C85, 1, -6211 }, { 0x1C86, 0x1C86, 1, -6204 }, { 0x1C87, 0x1C87, 1, -6180 },
+		{ 0x1C88, 0x1C88, 1, 35267 }, { 0x1C90, 0x1CBA, 1, -3008 }, { 0x1CBD, 0x1CBF, 1, -3008 }, { 0x1E00, 0x1E94, 2, 1 },
+		{ 0x1E9B, 0x1E9B, 1, -58 }, { 0x1E9E, 0x1E9E, 1, -7615 }, { 0x1EA0, 0x1EFE, 2, 1 }, { 0x1F08, 0x1F0F, 1, -8 },
+		{ 0x1F18, 0x1F1D, 1, -8 }, { 0x1F28, 0x1F2F, 1, -8 }, { 0x1F38, 0x1F3F, 1, -8 }, { 0x1F48, 0x1F4D, 1, -8 },
+		{ 0x1F59, 0x1F5F, 2, -8 }, { 0x1F68, 0x1F6F, 1, -8 }, { 0x1F88, 0x1F8F, 1, -8 }, { 0x1F98, 0x1F9F, 1, -8 },
+		{ 0x1FA8, 0x1FAF, 1, -8 }, { 0x1FB8, 0x1FB9, 1, -8 }, { 0x1FBA, 0x1FBB, 1, -74 }, { 0x1FBC, 0x1FBC, 1, -9 },
+		{ 0x1FBE, 0x1FBE, 1, -7173 }, { 0x1FC8, 0x1FCB, 1, -86 }, { 0x1FCC, 0x1FCC, 1, -9 }, { 0x1FD8, 0x1FD9, 1, -8 },
+		{ 0x1FDA, 0x1FDB, 1, -100 }, { 0x1FE8, 0x1FE9, 1, -8 }, { 0x1FEA, 0x1FEB, 1, -112 }, { 0x1FEC, 0x1FEC, 1, -7 },
+		{ 0x1FF8, 0x1FF9, 1, -128 }, { 0x1FFA, 0x1FFB, 1, -126 }, { 0x1FFC, 0x1FFC, 1, -9 }, { 0x2126, 0x2126, 1, -7517 },
+		{ 0x212A, 0x212A, 1, -8383 }, { 0x212B, 0x212B, 1, -8262 }, { 0x2132, 0x2132, 1, 28 }, { 0x2160, 0x216F, 1, 16 },
+		{ 0x2183, 0x2183, 1, 1 }, { 0x24B6, 0x24CF, 1, 26 }, { 0x2C00, 0x2C2F, 1, 48 }, { 0x2C60, 0x2C60, 1, 1 },
+		{ 0x2C62, 0x2C62, 1, -10743 }, { 0x2C63, 0x2C63, 1, -3814 }, { 0x2C64, 0x2C64, 1, -10727 }, { 0x2C67, 0x2C6B, 2, 1 },
+		{ 0x2C6D, 0x2C6D, 1, -10780 }, { 0x2C6E, 0x2C6E, 1, -10749 }, { 0x2C6F, 0x2C6F, 1, -10783 }, { 0x2C70, 0x2C70, 1, -10782 },
+		{ 0x2C72, 0x2C72, 1, 1 }, { 0x2C75, 0x2C75, 1, 1 }, { 0x2C7E, 0x2C7F, 1, -10815 }, { 0x2C80, 0x2CE2, 2, 1 },
+		{ 0x2CEB, 0x2CED, 2, 1 }, { 0x2CF2, 0x2CF2, 1, 1 }, { 0xA640, 0xA66C, 2, 1 }, { 0xA680, 0xA69A, 2, 1 },
+		{ 0xA722, 0xA72E, 2, 1 }, { 0xA732, 0xA76E, 2, 1 }, { 0xA779, 0xA77B, 2, 1 }, { 0xA77D, 0xA77D, 1, -35332 },
+		{ 0xA77E, 0xA786, 2, 1 }, { 0xA78B, 0xA78B, 1, 1 }, { 0xA78D, 0xA78D, 1, -42280 }, { 0xA790, 0xA792, 2, 1 },
+		{ 0xA796, 0xA7A8, 2, 1 }, { 0xA7AA, 0xA7AA, 1, -42308 }, { 0xA7AB, 0xA7AB, 1, -42319 }, { 0xA7AC, 0xA7AC, 1, -42315 },
+		{ 0xA7AD, 0xA7AD, 1, -42305 }, { 0xA7AE, 0xA7AE, 1, -42308 }, { 0xA7B0, 0xA7B0, 1, -42258 }, { 0xA7B1, 0xA7B1, 1, -42282 },
+		{ 0xA7B2, 0xA7B2, 1, -42261 }, { 0xA7B3, 0xA7B3, 1, 928 }, { 0xA7B4, 0xA7C2, 2, 1 }, { 0xA7C4, 0xA7C4, 1, -48 },
+		{ 0xA7C5, 0xA7C5, 1, -42307 }, { 0xA7C6, 0xA7C6, 1, -35384 }, { 0xA7C7, 0xA7C9, 2, 1 }, { 0xA7D0, 0xA7D0, 1, 1 },
+		{ 0xA7D6, 0xA7D8, 2, 1 }, { 0xA7F5, 0xA7F5, 1, 1 }, { 0xAB70, 0xABBF, 1, -38864 }, { 0xFF21, 0xFF3A, 1, 32 },
+		{ 0x10400, 0x10427, 1, 40 }, { 0x104B0, 0x104D3, 1, 40 }, { 0x10570, 0x10594, 2, 39 }, { 0x10571, 0x1057A, 1, 39 },
+		{ 0x1057C, 0x1058A, 1, 39 }, { 0x1058C, 0x10592, 1, 39 }, { 0x10594, 0x10595, 1, 39 }, { 0x10C80, 0x10CB2, 1, 64 },
+		{ 0x118A0, 0x118BF, 1, 32 }, { 0x16E40, 0x16E5F, 1, 32 }, { 0x1E900, 0x1E921, 1, 34 },
+	};
+
+	// NFKC of one code point followed by full case folding, where it differs from the simple folding:
+	// Latin, punctuation and letterlike symbols, number forms, enclosed alphanumerics, ligatures,
+	// fullwidth forms and mathematical alphanumerics. Single code point results as runs, the others as strings.
+	inline constexpr FoldRun normalize_runs[] = {
+		{ 0x00A0, 0x00A0, 1, -128 }, { 0x00AA, 0x00AA, 1, -73 }, { 0x00B2, 0x00B3, 1, -128 }, { 0x00B9, 0x00B9, 1, -136 },
+		{ 0x00BA, 0x00BA, 1, -75 }, { 0x2000, 0x2000, 1, -8160 }, { 0x2001, 0x2001, 1, -8161 }, { 0x2002, 0x2002, 1, -8162 },
+		{ 0x2003, 0x2003, 1, -8163 }, { 0x2004, 0x2004, 1, -8164 }, { 0x2005, 0x2005, 1, -8165 }, { 0x2006, 0x2006, 1, -8166 },
+		{ 0x2007, 0x2007, 1, -8167 }, { 0x2008, 0x2008, 1, -8168 }, { 0x2009, 0x2009, 1, -8169 }, { 0x200A, 0x200A, 1, -8170 },
+		{ 0x2011, 0x2011, 1, -1 }, { 0x2024, 0x2024, 1, -8182 }, { 0x202F, 0x202F, 1, -8207 }, { 0x205F, 0x205F, 1, -8255 },
+		{ 0x2070, 0x2070, 1, -8256 }, { 0x2071, 0x2071, 1, -8200 }, { 0x2074, 0x2079, 1, -8256 }, { 0x207A, 0x207A, 1, -8271 },
+		{ 0x207B, 0x207B, 1, 407 }, { 0x207C, 0x207C, 1, -8255 }, { 0x207D, 0x207E, 1, -8277 }, { 0x207F, 0x207F, 1, -8209 },
+		{ 0x2080, 0x2089, 1, -8272 }, { 0x208A, 0x208A, 1, -8287 }, { 0x208B, 0x208B, 1, 391 }, { 0x208C, 0x208C, 1, -8271 },
+		{ 0x208D, 0x208E, 1, -8293 }, { 0x2090, 0x2090, 1, -8239 }, { 0x2091, 0x2091, 1, -8236 }, { 0x2092, 0x2092, 1, -8227 },
+		{ 0x2093, 0x2093, 1, -8219 }, { 0x2094, 0x2094, 1, -7739 }, { 0x2095, 0x2095, 1, -8237 }, { 0x2096, 0x2099, 1, -8235 },
+		{ 0x209A, 0x209A, 1, -8234 }, { 0x209B, 0x209C, 1, -8232 }, { 0x2102, 0x2102, 1, -8351 }, { 0x2107, 0x2107, 1, -7852 },
+		{ 0x210A, 0x210B, 1, -8355 }, { 0x210C, 0x210C, 1, -8356 }, { 0x210D, 0x210D, 1, -8357 }, { 0x210E, 0x210E, 1, -8358 },
+		{ 0x210F, 0x210F, 1, -8168 }, { 0x2110, 0x2110, 1, -8359 }, { 0x2111, 0x2111, 1, -8360 }, { 0x2112, 0x2112, 1, -8358 },
+		{ 0x2113, 0x2115, 2, -8359 }, { 0x2119, 0x211B, 1, -8361 }, { 0x211C, 0x211C, 1, -8362 }, { 0x211D, 0x211D, 1, -8363 },
+		{ 0x2124, 0x2124, 1, -8362 }, { 0x2128, 0x2128, 1, -8366 }, { 0x212C, 0x212D, 1, -8394 }, { 0x212F, 0x212F, 1, -8394 },
+		{ 0x2130, 0x2131, 1, -8395 }, { 0x2133, 0x2133, 1, -8390 }, { 0x2134, 0x2134, 1, -8389 }, { 0x2135, 0x2138, 1, -7013 },
+		{ 0x2139, 0x2139, 1, -8400 }, { 0x213C, 0x213C, 1, -7548 }, { 0x213D, 0x213D, 1, -7562 }, { 0x213E, 0x213E, 1, -7563 },
+		{ 0x213F, 0x213F, 1, -7551 }, { 0x2140, 0x2140, 1, 209 }, { 0x2145, 0x2145, 1, -8417 }, { 0x2146, 0x2147, 1, -8418 },
+		{ 0x2148, 0x2149, 1, -8415 }, { 0x2160, 0x2160, 1, -8439 }, { 0x2164, 0x2164, 1, -8430 }, { 0x2169, 0x2169, 1, -8433 },
+		{ 0x216C, 0x216C, 1, -8448 }, { 0x216D, 0x216E, 1, -8458 }, { 0x216F, 0x216F, 1, -8450 }, { 0x2170, 0x2170, 1, -8455 },
+		{ 0x2174, 0x2174, 1, -8446 }, { 0x2179, 0x2179, 1, -8449 }, { 0x217C, 0x217C, 1, -8464 }, { 0x217D, 0x217E, 1, -8474 },
+		{ 0x217F, 0x217F, 1, -8466 }, { 0x2460, 0x2468, 1, -9263 }, { 0x24B6, 0x24CF, 1, -9301 }, { 0x24D0, 0x24E9, 1, -9327 },
+		{ 0x24EA, 0x24EA, 1, -9402 }, { 0xFB20, 0xFB20, 1, -62782 }, { 0xFB21, 0xFB21, 1, -62801 }, { 0xFB22, 0xFB23, 1, -62799 },
+		{ 0xFB24, 0xFB26, 1, -62793 }, { 0xFB27, 0xFB27, 1, -62783 }, { 0xFB28, 0xFB28, 1, -62782 }, { 0xFB29, 0xFB29, 1, -64254 },
+		{ 0xFF01, 0xFF20, 1, -65248 }, { 0xFF21, 0xFF3A, 1, -65216 }, { 0xFF3B, 0xFF5E, 1, -65248 }, { 0xFF5F, 0xFF60, 1, -54746 },
+		{ 0xFF61, 0xFF61, 1, -53087 }, { 0xFF62, 0xFF63, 1, -53078 }, { 0xFF64, 0xFF64, 1, -53091 }, { 0xFF65, 0xFF65, 1, -52842 },
+		{ 0xFF66, 0xFF66, 1, -52852 }, { 0xFF67, 0xFF67, 1, -52934 }, { 0xFF68, 0xFF68, 1, -52933 }, { 0xFF69, 0xFF69, 1, -52932 },
+		{ 0xFF6A, 0xFF6A, 1, -52931 }, { 0xFF6B, 0xFF6B, 1, -52930 }, { 0xFF6C, 0xFF6C, 1, -52873 }, { 0xFF6D, 0xFF6D, 1, -52872 },
+		{ 0xFF6E, 0xFF6E, 1, -52871 }, { 0xFF6F, 0xFF6F, 1, -52908 }, { 0xFF70, 0xFF70, 1, -52852 }, { 0xFF71, 0xFF71, 1, -52943 },
+		{ 0xFF72, 0xFF72, 1, -52942 }, { 0xFF73, 0xFF73, 1, -52941 }, { 0xFF74, 0xFF74, 1, -52940 }, { 0xFF75, 0xFF76, 1, -52939 },
+		{ 0xFF77, 0xFF77, 1, -52938 }, { 0xFF78, 0xFF78, 1, -52937 }, { 0xFF79, 0xFF79, 1, -52936 }, { 0xFF7A, 0xFF7A, 1, -52935 },
+		{ 0xFF7B, 0xFF7B, 1, -52934 }, { 0xFF7C, 0xFF7C, 1, -52933 }, { 0xFF7D, 0xFF7D, 1, -52932 }, { 0xFF7E, 0xFF7E, 1, -52931 },
+		{ 0xFF7F, 0xFF7F, 1, -52930 }, { 0xFF80, 0xFF80, 1, -52929 }, { 0xFF81, 0xFF81, 1, -52928 }, { 0xFF82, 0xFF82, 1, -52926 },
+		{ 0xFF83, 0xFF83, 1, -52925 }, { 0xFF84, 0xFF84, 1, -52924 }, { 0xFF85, 0xFF8A, 1, -52923 }, { 0xFF8B, 0xFF8B, 1, -52921 },
+		{ 0xFF8C, 0xFF8C, 1, -52919 }, { 0xFF8D, 0xFF8D, 1, -52917 }, { 0xFF8E, 0xFF8E, 1, -52915 }, { 0xFF8F, 0xFF93, 1, -52913 },
+		{ 0xFF94, 0xFF94, 1, -52912 }, { 0xFF95, 0xFF95, 1, -52911 }, { 0xFF96, 0xFF9B, 1, -52910 }, { 0xFF9C, 0xFF9C, 1, -52909 },
+		{ 0xFF9D, 0xFF9D, 1, -52906 }, { 0xFF9E, 0xFF9F, 1, -52997 }, { 0xFFA0, 0xFFA0, 1, -60992 }, { 0xFFA1, 0xFFA2, 1, -61089 },
+		{ 0xFFA3, 0xFFA5, 2, -60921 }, { 0xFFA4, 0xFFA4, 1, -61090 }, { 0xFFA5, 0xFFA6, 1, -60921 }, { 0xFFA7, 0xFFA9, 1, -61092 },
+		{ 0xFFAA, 0xFFAF, 1, -60922 }, { 0xFFB0, 0xFFB0, 1, -61078 }, { 0xFFB1, 0xFFB3, 1, -61099 }, { 0xFFB4, 0xFFB4, 1, -61075 },
+		{ 0xFFB5, 0xFFBE, 1, -61100 }, { 0xFFC2, 0xFFC7, 1, -61025 }, { 0xFFCA, 0xFFCF, 1, -61027 }, { 0xFFD2, 0xFFD7, 1, -61029 },
+		{ 0xFFDA, 0xFFDC, 1, -61031 }, { 0xFFE0, 0xFFE1, 1, -65342 }, { 0xFFE2, 0xFFE2, 1, -65334 }, { 0xFFE4, 0xFFE4, 1, -65342 },
+		{ 0xFFE5, 0xFFE5, 1, -65344 }, { 0xFFE6, 0xFFE6, 1, -57149 }, { 0xFFE8, 0xFFE8, 1, -56038 }, { 0xFFE9, 0xFFEC, 1, -56921 },
+		{ 0xFFED, 0xFFED, 1, -55885 }, { 0xFFEE, 0xFFEE, 1, -55843 }, { 0x1D400, 0x1D419, 1, -119711 }, { 0x1D41A, 0x1D433, 1, -119737 },
+		{ 0x1D434, 0x1D44D, 1, -119763 }, { 0x1D44E, 0x1D466, 2, -119789 }, { 0x1D44F, 0x1D454, 1, -119789 }, { 0x1D456, 0x1D467, 1, -119789 },
+		{ 0x1D468, 0x1D481, 1, -119815 }, { 0x1D482, 0x1D49B, 1, -119841 }, { 0x1D49C, 0x1D49E, 2, -119867 }, { 0x1D49F, 0x1D49F, 1, -119867 },
+		{ 0x1D4A2, 0x1D4A2, 1, -119867 }, { 0x1D4A5, 0x1D4A6, 1, -119867 }, { 0x1D4A9, 0x1D4AC, 1, -119867 }, { 0x1D4AE, 0x1D4B5, 1, -119867 },
+		{ 0x1D4B6, 0x1D4B9, 1, -119893 }, { 0x1D4BB, 0x1D4CF, 2, -119893 }, { 0x1D4BE, 0x1D4C3, 1, -119893 }, { 0x1D4C5, 0x1D4CF, 1, -119893 },
+		{ 0x1D4D0, 0x1D4E9, 1, -119919 }, { 0x1D4EA, 0x1D503, 1, -119945 }, { 0x1D504, 0x1D505, 1, -119971 }, { 0x1D507, 0x1D50A, 1, -119971 },
+		{ 0x1D50D, 0x1D514, 1, -119971 }, { 0x1D516, 0x1D51C, 1, -119971 }, { 0x1D51E, 0x1D537, 1, -119997 }, { 0x1D538, 0x1D539, 1, -120023 },
+		{ 0x1D53B, 0x1D53E, 1, -120023 }, { 0x1D540, 0x1D544, 1, -120023 }, { 0x1D546, 0x1D546, 1, -120023 }, { 0x1D54A, 0x1D550, 1, -120023 },
+		{ 0x1D552, 0x1D56B, 1, -120049 }, { 0x1D56C, 0x1D585, 1, -120075 }, { 0x1D586, 0x1D59F, 1, -120101 }, { 0x1D5A0, 0x1D5B9, 1, -120127 },
+		{ 0x1D5BA, 0x1D5D3, 1, -120153 }, { 0x1D5D4, 0x1D5ED, 1, -120179 }, { 0x1D5EE, 0x1D607, 1, -120205 }, { 0x1D608, 0x1D621, 1, -120231 },
+		{ 0x1D622, 0x1D63B, 1, -120257 }, { 0x1D63C, 0x1D655, 1, -120283 }, { 0x1D656, 0x1D66F, 1, -120309 }, { 0x1D670, 0x1D689, 1, -120335 },
+		{ 0x1D68A, 0x1D6A3, 1, -120361 }, { 0x1D6A4, 0x1D6A4, 1, -120179 }, { 0x1D6A5, 0x1D6A5, 1, -119918 }, { 0x1D6A8, 0x1D6B8, 1, -119543 },
+		{ 0x1D6B9, 0x1D6B9, 1, -119553 }, { 0x1D6BA, 0x1D6C0, 1, -119543 }, { 0x1D6C1, 0x1D6C1, 1, -111802 }, { 0x1D6C2, 0x1D6D2, 1, -119569 },
+		{ 0x1D6D3, 0x1D6D3, 1, -119568 }, { 0x1D6D4, 0x1D6DA, 1, -119569 }, { 0x1D6DB, 0x1D6DB, 1, -111833 }, { 0x1D6DC, 0x1D6DC, 1, -119591 },
+		{ 0x1D6DD, 0x1D6DD, 1, -119589 }, { 0x1D6DE, 0x1D6DE, 1, -119588 }, { 0x1D6DF, 0x1D6DF, 1, -119577 }, { 0x1D6E0, 0x1D6E0, 1, -119583 },
+		{ 0x1D6E1, 0x1D6E1, 1, -119585 }, { 0x1D6E2, 0x1D6F2, 1, -119601 }, { 0x1D6F3, 0x1D6F3, 1, -119611 }, { 0x1D6F4, 0x1D6FA, 1, -119601 },
+		{ 0x1D6FB, 0x1D6FB, 1, -111860 }, { 0x1D6FC, 0x1D70C, 1, -119627 }, { 0x1D70D, 0x1D70D, 1, -119626 }, { 0x1D70E, 0x1D714, 1, -119627 },
+		{ 0x1D715, 0x1D715, 1, -111891 }, { 0x1D716, 0x1D716, 1, -119649 }, { 0x1D717, 0x1D717, 1, -119647 }, { 0x1D718, 0x1D718, 1, -119646 },
+		{ 0x1D719, 0x1D719, 1, -119635 }, { 0x1D71A, 0x1D71A, 1, -119641 }, { 0x1D71B, 0x1D71B, 1, -119643 }, { 0x1D71C, 0x1D72C, 1, -119659 },
+		{ 0x1D72D, 0x1D72D, 1, -119669 }, { 0x1D72E, 0x1D734, 1, -119659 }, { 0x1D735, 0x1D735, 1, -111918 }, { 0x1D736, 0x1D746, 1, -119685 },
+		{ 0x1D747, 0x1D747, 1, -119684 }, { 0x1D748, 0x1D74E, 1, -119685 }, { 0x1D74F, 0x1D74F, 1, -111949 }, { 0x1D750, 0x1D750, 1, -119707 },
+		{ 0x1D751, 0x1D751, 1, -119705 }, { 0x1D752, 0x1D752, 1, -119704 }, { 0x1D753, 0x1D753, 1, -119693 }, { 0x1D754, 0x1D754, 1, -119699 },
+		{ 0x1D755, 0x1D755, 1, -119701 }, { 0x1D756, 0x1D766, 1, -119717 }, { 0x1D767, 0x1D767, 1, -119727 }, { 0x1D768, 0x1D76E, 1, -119717 },
+		{ 0x1D76F, 0x1D76F, 1, -111976 }, { 0x1D770, 0x1D780, 1, -119743 }, { 0x1D781, 0x1D781, 1, -119742 }, { 0x1D782, 0x1D788, 1, -119743 },
+		{ 0x1D789, 0x1D789, 1, -112007 }, { 0x1D78A, 0x1D78A, 1, -119765 }, { 0x1D78B, 0x1D78B, 1, -119763 }, { 0x1D78C, 0x1D78C, 1, -119762 },
+		{ 0x1D78D, 0x1D78D, 1, -119751 }, { 0x1D78E, 0x1D78E, 1, -119757 }, { 0x1D78F, 0x1D78F, 1, -119759 }, { 0x1D790, 0x1D7A0, 1, -119775 },
+		{ 0x1D7A1, 0x1D7A1, 1, -119785 }, { 0x1D7A2, 0x1D7A8, 1, -119775 }, { 0x1D7A9, 0x1D7A9, 1, -112034 }, { 0x1D7AA, 0x1D7BA, 1, -119801 },
+		{ 0x1D7BB, 0x1D7BB, 1, -119800 }, { 0x1D7BC, 0x1D7C2, 1, -119801 }, { 0x1D7C3, 0x1D7C3, 1, -112065 }, { 0x1D7C4, 0x1D7C4, 1, -119823 },
+		{ 0x1D7C5, 0x1D7C5, 1, -119821 }, { 0x1D7C6, 0x1D7C6, 1, -119820 }, { 0x1D7C7, 0x1D7C7, 1, -119809 }, { 0x1D7C8, 0x1D7C8, 1, -119815 },
+		{ 0x1D7C9, 0x1D7C9, 1, -119817 }, { 0x1D7CA, 0x1D7CA, 1, -119789 }, { 0x1D7CB, 0x1D7CB, 1, -119790 }, { 0x1D7CE, 0x1D7D7, 1, -120734 },
+		{ 0x1D7D8, 0x1D7E1, 1, -120744 }, { 0x1D7E2, 0x1D7EB, 1, -120754 }, { 0x1D7EC, 0x1D7F5, 1, -120764 }, { 0x1D7F6, 0x1D7FF, 1, -120774 },
+	};
+
+	inline constexpr FoldString normalize_strings[] = {
+		{ 0x00A8, " \314\210" }, { 0x00AF, " \314\204" }, { 0x00B4, " \314\201" }, { 0x00B8, " \314\247" }, { 0x00BC, "1\342\201\2044" }, { 0x00BD, "1\342\201\2042" },
+		{ 0x00BE, "3\342\201\2044" }, { 0x00DF, "ss" }, { 0x0130, "i\314\207" }, { 0x0132, "ij" }, { 0x0133, "ij" }, { 0x013F, "l\302\267" },
+		{ 0x0140, "l\302\267" }, { 0x0149, "\312\274n" }, { 0x01C4, "d\305\276" }, { 0x01C5, "d\305\276" }, { 0x01C6, "d\305\276" }, { 0x01C7, "lj" },
+		{ 0x01C8, "lj" }, { 0x01C9, "lj" }, { 0x01CA, "nj" }, { 0x01CB, "nj" }, { 0x01CC, "nj" }, { 0x01F1, "dz" },
+		{ 0x01F2, "dz" }, { 0x01F3, "dz" }, { 0x1E9A, "a\312\276" }, { 0x1E9E, "ss" }, { 0x2017, " \314\263" }, { 0x2025, ".." },
+		{ 0x2026, "..." }, { 0x2033, "\342\200\262\342\200\262" }, { 0x2036, "\342\200\265\342\200\265" }, { 0x203C, "!!" }, { 0x203E, " \314\205" }, { 0x2047, "??" },
+		{ 0x2048, "?!" }, { 0x2049, "!?" }, { 0x20A8, "rs" }, { 0x2100, "a/c" }, { 0x2101, "a/s" }, { 0x2103, "\302\260c" },
+		{ 0x2105, "c/o" }, { 0x2106, "c/u" }, { 0x2109, "\302\260f" }, { 0x2116, "no" }, { 0x2120, "sm" }, { 0x2121, "tel" },
+		{ 0x2122, "tm" }, { 0x213B, "fax" }, { 0x2150, "1\342\201\2047" }, { 0x2151, "1\342\201\2049" }, { 0x2152, "1\342\201\20410" }, { 0x2153, "1\342\201\2043" },
+		{ 0x2154, "2\342\201\2043" }, { 0x2155, "1\342\201\2045" }, { 0x2156, "2\342\201\2045" }, { 0x2157, "3\342\201\2045" }, { 0x2158, "4\342\201\2045" }, { 0x2159, "1\342\201\2046" },
+		{ 0x215A, "5\342\201\2046" }, { 0x215B, "1\342\201\2048" }, { 0x215C, "3\342\201\2048" }, { 0x215D, "5\342\201\2048" }, { 0x215E, "7\342\201\2048" }, { 0x215F, "1\342\201\204" },
+		{ 0x2161, "ii" }, { 0x2162, "iii" }, { 0x2163, "iv" }, { 0x2165, "vi" }, { 0x2166, "vii" }, { 0x2167, "viii" },
+		{ 0x2168, "ix" }, { 0x216A, "xi" }, { 0x216B, "xii" }, { 0x2171, "ii" }, { 0x2172, "iii" }, { 0x2173, "iv" },
+		{ 0x2175, "vi" }, { 0x2176, "vii" }, { 0x2177, "viii" }, { 0x2178, "ix" }, { 0x217A, "xi" }, { 0x217B, "xii" },
+		{ 0x2189, "0\342\201\2043" }, { 0x2469, "10" }, { 0x246A, "11" }, { 0x246B, "12" }, { 0x246C, "13" }, { 0x246D, "14" },
+		{ 0x246E, "15" }, { 0x246F, "16" }, { 0x2470, "17" }, { 0x2471, "18" }, { 0x2472, "19" }, { 0x2473, "20" },
+		{ 0x2474, "(1)" }, { 0x2475, "(2)" }, { 0x2476, "(3)" }, { 0x2477, "(4)" }, { 0x2478, "(5)" }, { 0x2479, "(6)" },
+		{ 0x247A, "(7)" }, { 0x247B, "(8)" }, { 0x247C, "(9)" }, { 0x247D, "(10)" }, { 0x247E, "(11)" }, { 0x247F, "(12)" },
+		{ 0x2480, "(13)" }, { 0x2481, "(14)" }, { 0x2482, "(15)" }, { 0x2483, "(16)" }, { 0x2484, "(17)" }, { 0x2485, "(18)" },
+		{ 0x2486, "(19)" }, { 0x2487, "(20)" }, { 0x2488, "1." }, { 0x2489, "2." }, { 0x248A, "3." }, { 0x248B, "4." },
+		{ 0x248C, "5." }, { 0x248D, "6." }, { 0x248E, "7." }, { 0x248F, "8." }, { 0x2490, "9." }, { 0x2491, "10." },
+		{ 0x2492, "11." }, { 0x2493, "12." }, { 0x2494, "13." }, { 0x2495, "14." }, { 0x2496, "15." }, { 0x2497, "16." },
+		{ 0x2498, "17." }, { 0x2499, "18." }, { 0x249A, "19." }, { 0x249B, "20." }, { 0x249C, "(a)" }, { 0x249D, "(b)" },
+		{ 0x249E, "(c)" }, { 0x249F, "(d)" }, { 0x24A0, "(e)" }, { 0x24A1, "(f)" }, { 0x24A2, "(g)" }, { 0x24A3, "(h)" },
+		{ 0x24A4, "(i)" }, { 0x24A5, "(j)" }, { 0x24A6, "(k)" }, { 0x24A7, "(l)" }, { 0x24A8, "(m)" }, { 0x24A9, "(n)" },
+		{ 0x24AA, "(o)" }, { 0x24AB, "(p)" }, { 0x24AC, "(q)" }, { 0x24AD, "(r)" }, { 0x24AE, "(s)" }, { 0x24AF, "(t)" },
+		{ 0x24B0, "(u)" }, { 0x24B1, "(v)" }, { 0x24B2, "(w)" }, { 0x24B3, "(x)" }, { 0x24B4, "(y)" }, { 0x24B5, "(z)" },
+		{ 0xFB00, "ff" }, { 0xFB01, "fi" }, { 0xFB02, "fl" }, { 0xFB03, "ffi" }, { 0xFB04, "ffl" }, { 0xFB05, "st" },
+		{ 0xFB06, "st" }, { 0xFB13, "\325\264\325\266" }, { 0xFB14, "\325\264\325\245" }, { 0xFB15, "\325\264\325\253" }, { 0xFB16, "\325\276\325\266" }, { 0xFB17, "\325\264\325\255" },
+		{ 0xFB1D, "\327\231\326\264" }, { 0xFB1F, "\327\262\326\267" }, { 0xFB2A, "\327\251\327\201" }, { 0xFB2B, "\327\251\327\202" }, { 0xFB2C, "\327\251\326\274\327\201" }, { 0xFB2D, "\327\251\326\274\327\202" },
+		{ 0xFB2E, "\327\220\326\267" }, { 0xFB2F, "\327\220\326\270" }, { 0xFB30, "\327\220\326\274" }, { 0xFB31, "\327\221\326\274" }, { 0xFB32, "\327\222\326\274" }, { 0xFB33, "\327\223\326\274" },
+		{ 0xFB34, "\327\224\326\274" }, { 0xFB35, "\327\225\326\274" }, { 0xFB36, "\327\226\326\274" }, { 0xFB38, "\327\230\326\274" }, { 0xFB39, "\327\231\326\274" }, { 0xFB3A, "\327\232\326\274" },
+		{ 0xFB3B, "\327\233\326\274" }, { 0xFB3C, "\327\234\326\274" }, { 0xFB3E, "\327\236\326\274" }, { 0xFB40, "\327\240\326\274" }, { 0xFB41, "\327\241\326\274" }, { 0xFB43, "\327\243\326\274" },
+		{ 0xFB44, "\327\244\326\274" }, { 0xFB46, "\327\246\326\274" }, { 0xFB47, "\327\247\326\274" }, { 0xFB48, "\327\250\326\274" }, { 0xFB49, "\327\251\326\274" }, { 0xFB4A, "\327\252\326\274" },
+		{ 0xFB4B, "\327\225\326\271" }, { 0xFB4C, "\327\221\326\277" }, { 0xFB4D, "\327\233\326\277" }, { 0xFB4E, "\327\244\326\277" }, { 0xFB4F, "\327\220\327\234" }, { 0xFFE3, " \314\204" },
+	};
+};
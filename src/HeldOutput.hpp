@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Formatted output of completed results that can't be written yet (--sort), so their occurrences can be released.
+// Blocks are kept in memory up to a budget, beyond it they go to an anonymous temporary file and are read back
+// when written. Memory stays flat however many occurrences a search holds back. Without a temporary file
+// everything stays in memory.
+class HeldOutput {
+	struct Block {
+		std::string text; // while in memory
+		int64_t offset = -1; // in the file once spilled
+		size_t size = 0;
+	};
+	std::vector<Block> blocks;
+	size_t in_memory = 0; // bytes of the blocks in memory
+	FILE* file = nullptr;
+	int64_t file_size = 0;
+	bool no_file = false; // creating it failed, don't try again
+
+	bool seek(int64_t offset) {
+	#ifdef _WIN32
+		return _fseeki64(file, offset, SEEK_SET) == 0;
+	#else
+		return fseeko(file, off_t(offset), SEEK_SET) == 0;
+	#endif
+	}
+
+	bool spill(Block& b) {
+		if (!file && !no_file) {
+			file = std::tmpfile();
+			no_file = !file;
+		}
+		if (!file || !seek(file_size) || std::fwrite(b.text.data(), 1, b.text.size(), file) != b.text.size())
+			return false;
+		b.offset = file_size;
+		file_size += int64_t(b.text.size());
+		std::string().swap(b.text);
+		return true;
+	}
+
+public:
+	size_t budget = size_t(64) << 20; // bytes kept in memory, set before the first add()
+
+	HeldOutput() = default;
+	HeldOutput(const HeldOutput&) = delete;
+	HeldOutput& operator=(const HeldOutput&) = delete;
+	~HeldOutput() { if (file) std::fclose(file); }
+
+	// Holds a block, returns its id for take()
+	size_t add(std::string&& text) {
+		Block b;
+		b.size = text.size();
+		b.text = std::move(text);
+		bool spilled = b.size > 0 && in_memory + b.size > budget && spill(b);
+		if (!spilled)
+			in_memory += b.size;
+		blocks.push_back(std::move(b));
+		return blocks.size() - 1;
+	}
+
+	// Appends a block to out and frees it, each block is taken once
+	void take(size_t id, std::string& out) {
+		Block& b = blocks[id];
+		if (b.offset < 0) {
+			out += b.text;
+			in_memory -= b.size;
+			std::string().swap(b.text);
+			b.size = 0;
+			return;
+		}
+		size_t start = out.size();
+		out.resize(start + b.size);
+		if (!seek(b.offset) || std::fread(&out[start], 1, b.size, file) != b.size)
+			out.resize(start); // the file went bad, the block is lost rather than garbage written
+		b.offset = -1;
+		b.size = 0;
+	}
+
+	// Bytes that went to the temporary file, for --stats
+	int64_t spilled() const { return file_size; }
+};
@@ -0,0 +1,463 @@
+#pragma once
+
+#include "TextCache.hpp"
+#include "MappedFile.hpp"
+#include "TextFolder.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+
+struct Posting {
+	uint32_t file;
+	uint32_t page; // zero based
+
+	bool operator<(const Posting& o) const { return file < o.file || (file == o.file && page < o.page); }
+	bool operator==(const Posting& o) const { return file == o.file && page == o.page; }
+};
+
+namespace token {
+	// Letters, digits and every non-ASCII byte (so UTF-8 sequences stay inside a token)
+	inline bool is_token_char(unsigned char c) {
+		return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+	}
+
+	// Calls f(std::string) for every token of text, ASCII lowercased. Text and queries are folded with
+	// TextFolder(true) first, normalization only merges more spellings so it serves both search modes.
+	template<typename F>
+	void for_each(std::string_view text, F&& f) {
+		std::string tok;
+		for (size_t i = 0; i <= text.size(); ++i) {
+			unsigned char c = i < text.size() ? (unsigned char)text[i] : ' ';
+			if (is_token_char(c)) {
+				tok += (char)std::tolower(c);
+			} else if (!tok.empty()) {
+				f(tok);
+				tok.clear();
+			}
+		}
+	}
+};
+
+// Inverted index over the extracted text of a directory tree: token -> posting list of (file, page).
+// It is used in place through a memory mapping, so opening an index costs no deserialization.
+// Pages with a hyphen at a line end are tokenized joined as well, so --join-lines queries are narrowed too.
+//
+// Layout, native endianness, offsets relative to the start of the file:
+//   Header
+//   Entry   files[fileCount]       file id = position
+//   Term    terms[termCount]       sorted by term bytes
+//   char    strings[]              file paths and term bytes
+//   Posting postings[]             per term, sorted by (file, page)
+//   Suffix  suffixes[suffixCount]  every suffix of every term, sorted by its bytes
+class PdfIndex {
+public:
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t fileCount;
+		uint64_t termCount;
+		uint64_t filesOffset;
+		uint64_t termsOffset;
+		uint64_t stringsOffset;
+		uint64_t postingsOffset;
+		uint64_t suffixCount;
+		uint64_t suffixesOffset;
+	};
+	struct Entry {
+		uint64_t pathOffset;
+		uint32_t pathLength;
+		uint32_t pageCount;
+		uint64_t size;
+		int64_t mtime;
+	};
+	struct Term {
+		uint64_t textOffset;
+		uint32_t textLength;
+		uint32_t postingCount;
+		uint64_t postingsOffset;
+	};
+	// Terms that end in or contain a query token are found by a binary search over their suffixes
+	struct Suffix {
+		uint32_t term;
+		uint32_t offset;
+	};
+
+	static constexpr char magic[8] = { 'P','D','F','M','S','I','X','1' };
+	static constexpr uint32_t version = 4; // 2: tokens are Unicode folded and normalized, 3: suffix table, 4: joined words
+
+private:
+	MappedFile map;
+	const Header* header = nullptr;
+	const Entry* files = nullptr;
+	const Term* terms = nullptr;
+	const Suffix* suffixes = nullptr;
+
+	bool inBounds(uint64_t offset, uint64_t length) const { return offset <= map.size() && length <= map.size() - offset; }
+
+public:
+	// One index per directory tree, stored next to the text cache
+	static fs::path location(const fs::path& cacheDir, const fs::path& root) {
+		std::error_code ec;
+		fs::path canonical = fs::weakly_canonical(fs::absolute(root, ec), ec);
+		char name[17];
+		snprintf(name, sizeof(name), "%016llx", (unsigned long long)pdf::fnv1a(canonical.u8string()));
+		return cacheDir / (std::string(name) + ".pdfmsidx");
+	}
+
+	bool open(const fs::path& path) {
+		header = nullptr;
+		if (!map.open(path) || map.size() < sizeof(Header))
+			return false;
+		auto h = reinterpret_cast<const Header*>(map.data());
+		if (!std::equal(h->magic, h->magic + sizeof(magic), magic) || h->version != version)
+			return false;
+		if (!inBounds(h->filesOffset, uint64_t(h->fileCount) * sizeof(Entry)) ||
+			!inBounds(h->termsOffset, h->termCount * sizeof(Term)) ||
+			!inBounds(h->suffixesOffset, h->suffixCount * sizeof(Suffix)) ||
+			h->stringsOffset > map.size() || h->postingsOffset > map.size())
+			return false;
+		files = reinterpret_cast<const Entry*>(map.data() + h->filesOffset);
+		terms = reinterpret_cast<const Term*>(map.data() + h->termsOffset);
+		suffixes = reinterpret_cast<const Suffix*>(map.data() + h->suffixesOffset);
+		for (uint32_t i = 0; i < h->fileCount; ++i)
+			if (!inBounds(files[i].pathOffset, files[i].pathLength)) return false;
+		for (uint64_t i = 0; i < h->termCount; ++i)
+			if (!inBounds(terms[i].textOffset, terms[i].textLength) ||
+				!inBounds(terms[i].postingsOffset, uint64_t(terms[i].postingCount) * sizeof(Posting)))
+				return false;
+		header = h;
+		return true;
+	}
+
+	void close() { map.close(); header = nullptr; }
+
+	bool isOpen() const { return header != nullptr; }
+	uint32_t fileCount() const { return header ? header->fileCount : 0; }
+	size_t termCount() const { return header ? header->termCount : 0; }
+
+	const Entry& file(uint32_t i) const { return files[i]; }
+	std::string_view filePath(uint32_t i) const { return std::string_view(map.data() + files[i].pathOffset, files[i].pathLength); }
+	FileKey fileKey(uint32_t i) const { return FileKey{ std::string(filePath(i)), files[i].size, files[i].mtime }; }
+
+	std::string_view term(size_t i) const { return std::string_view(map.data() + terms[i].textOffset, terms[i].textLength); }
+	const Posting* postings(size_t i) const { return reinterpret_cast<const Posting*>(map.data() + terms[i].postingsOffset); }
+	uint32_t postingCount(size_t i) const { return terms[i].postingCount; }
+
+	// Checked here rather than in open(), there are as many suffixes as term bytes
+	size_t suffixCount() const { return header ? header->suffixCount : 0; }
+	std::string_view suffix(size_t i) const {
+		const Suffix& s = suffixes[i];
+		return s.term < termCount() && s.offset < terms[s.term].textLength ? term(s.term).substr(s.offset) : std::string_view();
+	}
+
+	// Okapi BM25 of every file for the candidate pages of each pattern. The index knows pages rather than
+	// occurrences, so a pattern's frequency in a file is the number of its candidate pages there and the length
+	// of a file is its page count.
+	std::vector<double> bm25(const std::vector<std::vector<Posting>>& pattern_pages, double k1 = 1.2, double b = 0.75) const {
+		const uint32_t n = fileCount();
+		std::vector<double> scores(n, 0.0);
+		if (n == 0)
+			return scores;
+		double avg_pages = 0;
+		for (uint32_t f = 0; f < n; ++f) avg_pages += files[f].pageCount;
+		avg_pages = std::max(1.0, avg_pages / n);
+		std::vector<uint32_t> tf(n);
+		for (const auto& pages : pattern_pages) {
+			std::fill(tf.begin(), tf.end(), 0);
+			size_t df = 0;
+			for (const Posting& p : pages)
+				if (p.file < n && tf[p.file]++ == 0) df++;
+			double idf = std::log(1 + (double(n) - double(df) + 0.5) / (double(df) + 0.5));
+			for (uint32_t f = 0; f < n; ++f) {
+				if (!tf[f]) continue;
+				double norm = k1 * (1 - b + b * files[f].pageCount / avg_pages);
+				scores[f] += idf * tf[f] * (k1 + 1) / (tf[f] + norm);
+			}
+		}
+		return scores;
+	}
+
+	// Pages that may contain queryLower (folded with TextFolder(true)) as a substring, sorted by (file, page).
+	// Returns false when the query has no token the index could narrow down (e.g. only punctuation).
+	bool candidates(const std::string& queryLower, std::vector<Posting>& out) const {
+		std::vector<std::string> qtokens;
+		token::for_each(queryLower, [&](const std::string& t) { qtokens.push_back(t); });
+		if (qtokens.empty())
+			return false;
+
+		// Inner tokens must be whole words, the outer ones may continue into the surrounding text
+		bool openLeft = token::is_token_char(queryLower.front());
+		bool openRight = token::is_token_char(queryLower.back());
+
+		out.clear();
+		std::vector<Posting> pages, merged;
+		std::vector<uint32_t> matched;
+		for (size_t q = 0; q < qtokens.size(); ++q) {
+			const std::string& qt = qtokens[q];
+			bool left = q == 0 && openLeft;
+			bool right = q + 1 == qtokens.size() && openRight;
+
+			pages.clear();
+			auto collect = [&](size_t t) { pages.insert(pages.end(), postings(t), postings(t) + postingCount(t)); };
+			if (!left) {
+				// Exact or prefix lookup: binary search over the sorted term table
+				size_t lo = 0, hi = termCount();
+				while (lo < hi) {
+					size_t mid = (lo + hi) / 2;
+					if (term(mid) < std::string_view(qt)) lo = mid + 1; else hi = mid;
+				}
+				for (size_t t = lo; t < termCount(); ++t) {
+					std::string_view tv = term(t);
+					if (tv.compare(0, qt.size(), qt) != 0) break;
+					if (right || tv.size() == qt.size()) collect(t);
+					if (!right) break;
+				}
+			} else {
+				// Substring or suffix lookup: the suffixes starting with the token are one range of the suffix table,
+				// a term that contains the token more than once is in it more than once
+				size_t lo = 0, hi = suffixCount();
+				while (lo < hi) {
+					size_t mid = (lo + hi) / 2;
+					if (suffix(mid) < std::string_view(qt)) lo = mid + 1; else hi = mid;
+				}
+				matched.clear();
+				for (size_t i = lo; i < suffixCount(); ++i) {
+					std::string_view sv = suffix(i);
+					if (sv.compare(0, qt.size(), qt) != 0) break;
+					if (right || sv.size() == qt.size()) matched.push_back(suffixes[i].term);
+				}
+				std::sort(matched.begin(), matched.end());
+				matched.erase(std::unique(matched.begin(), matched.end()), matched.end());
+				for (uint32_t t : matched) collect(t);
+			}
+			std::sort(pages.begin(), pages.end());
+			pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+			if (q == 0) {
+				out.swap(pages);
+			} else {
+				merged.clear();
+				std::set_intersection(out.begin(), out.end(), pages.begin(), pages.end(), std::back_inserter(merged));
+				out.swap(merged);
+			}
+			if (out.empty()) break;
+		}
+		return true;
+	}
+};
+
+// Builds or incrementally updates a PdfIndex. Files whose key still matches the previous index
+// keep their postings, everything else is extracted through the text cache.
+struct PdfIndexBuilder {
+	struct Stats {
+		size_t reused = 0;
+		size_t extracted = 0;
+		std::vector<std::string> erroredPaths;
+		size_t terms = 0;
+	};
+
+	static bool build(const std::vector<fs::path>& pdfFiles, const TextCache& cache, const fs::path& indexPath, Stats& stats) {
+		struct FileInfo {
+			FileKey key;
+			uint32_t pageCount = 0;
+			bool ok = false;
+			bool reused = false;
+		};
+		std::vector<FileInfo> infos(pdfFiles.size());
+		for (size_t i = 0; i < pdfFiles.size(); ++i)
+			infos[i].ok = FileKey::fromPath(pdfFiles[i], infos[i].key);
+
+		std::unordered_map<std::string, std::vector<Posting>> postings;
+		std::vector<size_t> todo;
+
+		{ // --- Reuse unchanged files from the previous index ---
+			PdfIndex previous;
+			std::unordered_map<uint32_t, uint32_t> oldToNew;
+			if (previous.open(indexPath)) {
+				std::unordered_map<std::string_view, uint32_t> byPath;
+				for (uint32_t f = 0; f < previous.fileCount(); ++f)
+					byPath.emplace(previous.filePath(f), f);
+				for (size_t i = 0; i < infos.size(); ++i) {
+					if (!infos[i].ok) continue;
+					auto it = byPath.find(infos[i].key.path);
+					if (it != byPath.end() && previous.fileKey(it->second) == infos[i].key) {
+						oldToNew[it->second] = uint32_t(i);
+						infos[i].pageCount = previous.file(it->second).pageCount;
+						infos[i].reused = true;
+						stats.reused++;
+					}
+				}
+				for (size_t t = 0; t < previous.termCount() && !oldToNew.empty(); ++t) {
+					std::vector<Posting>* list = nullptr;
+					for (uint32_t p = 0; p < previous.postingCount(t); ++p) {
+						Posting post = previous.postings(t)[p];
+						auto it = oldToNew.find(post.file);
+						if (it == oldToNew.end()) continue;
+						if (!list) list = &postings[std::string(previous.term(t))];
+						list->push_back(Posting{ it->second, post.page });
+					}
+				}
+			}
+			for (size_t i = 0; i < infos.size(); ++i) {
+				if (!infos[i].ok)
+					stats.erroredPaths.push_back(pdfFiles[i].u8string());
+				else if (!infos[i].reused)
+					todo.push_back(i);
+			}
+		} // previous index unmapped here, so it can be replaced below
+
+		// --- Extract and tokenize new or changed files ---
+		std::atomic<size_t> next{ 0 };
+		std::mutex merge_mutex;
+		auto worker_func = [&]() {
+			std::unordered_map<std::string, std::vector<Posting>> local;
+			std::vector<std::string> pages;
+			const TextFolder folder(true), joiner(true, true);
+			std::string folded;
+			while (true) {
+				size_t n = next.fetch_add(1);
+				if (n >= todo.size()) break;
+				size_t i = todo[n];
+
+				bool ok = cache.load(infos[i].key, pages);
+				if (!ok) {
+					std::string pdf_path_str;
+					try {
+						pdf_path_str = pdfFiles[i].string();
+						ok = pdf::extract_pages(pdf_path_str, pages);
+					} catch (...) {
+						ok = false;
+					}
+					if (ok) cache.store(infos[i].key, pages);
+				}
+				if (!ok) {
+					std::lock_guard<std::mutex> lock(merge_mutex);
+					infos[i].ok = false;
+					stats.erroredPaths.push_back(pdfFiles[i].u8string());
+					continue;
+				}
+
+				infos[i].pageCount = uint32_t(pages.size());
+				for (uint32_t p = 0; p < pages.size(); ++p) {
+					std::string_view text = pages[p];
+					if (!TextFolder::is_ascii(text)) {
+						folded = folder.fold(text);
+						text = folded;
+					}
+					auto add = [&](const std::string& t) {
+						auto& list = local[t];
+						Posting post{ uint32_t(i), p };
+						if (list.empty() || !(list.back() == post)) list.push_back(post);
+					};
+					token::for_each(text, add);
+					// "perfor-\nmance" is indexed as "performance" too, for --join-lines
+					if (TextFolder::has_hyphen_break(pages[p])) {
+						folded = joiner.fold(pages[p]);
+						token::for_each(folded, add);
+					}
+				}
+			}
+			std::lock_guard<std::mutex> lock(merge_mutex);
+			for (auto& kv : local) {
+				auto& list = postings[kv.first];
+				list.insert(list.end(), kv.second.begin(), kv.second.end());
+			}
+		};
+		std::vector<std::thread> pool;
+		size_t num_threads = std::max<size_t>(1, std::thread::hardware_concurrency() - 1);
+		for (size_t i = 0; i < num_threads; ++i)
+			pool.emplace_back(worker_func);
+		for (auto& t : pool) t.join();
+		stats.extracted = todo.size() - std::count_if(todo.begin(), todo.end(), [&](size_t i) { return !infos[i].ok; });
+
+		// --- Serialize ---
+		std::vector<uint32_t> fileIds(infos.size(), UINT32_MAX); // old position -> compact file id
+		std::vector<PdfIndex::Entry> entries;
+		std::string strings;
+		for (size_t i = 0; i < infos.size(); ++i) {
+			if (!infos[i].ok) continue;
+			fileIds[i] = uint32_t(entries.size());
+			entries.push_back(PdfIndex::Entry{ strings.size(), uint32_t(infos[i].key.path.size()), infos[i].pageCount, infos[i].key.size, infos[i].key.mtime });
+			strings += infos[i].key.path;
+		}
+
+		std::vector<const std::string*> sortedTerms;
+		sortedTerms.reserve(postings.size());
+		for (auto& kv : postings) {
+			auto& list = kv.second;
+			for (auto& p : list) p.file = fileIds[p.file];
+			list.erase(std::remove_if(list.begin(), list.end(), [](const Posting& p) { return p.file == UINT32_MAX; }), list.end());
+			if (list.empty()) continue;
+			std::sort(list.begin(), list.end());
+			list.erase(std::unique(list.begin(), list.end()), list.end());
+			sortedTerms.push_back(&kv.first);
+		}
+		std::sort(sortedTerms.begin(), sortedTerms.end(), [](const std::string* a, const std::string* b) { return *a < *b; });
+
+		PdfIndex::Header header{};
+		std::copy(PdfIndex::magic, PdfIndex::magic + sizeof(PdfIndex::magic), header.magic);
+		header.version = PdfIndex::version;
+		header.fileCount = uint32_t(entries.size());
+		header.termCount = sortedTerms.size();
+		header.filesOffset = sizeof(PdfIndex::Header);
+		header.termsOffset = header.filesOffset + entries.size() * sizeof(PdfIndex::Entry);
+
+		std::vector<PdfIndex::Term> termTable;
+		termTable.reserve(sortedTerms.size());
+		uint64_t postingBytes = 0;
+		for (auto t : sortedTerms) {
+			termTable.push_back(PdfIndex::Term{ strings.size(), uint32_t(t->size()), uint32_t(postings[*t].size()), postingBytes });
+			strings += *t;
+			postingBytes += postings[*t].size() * sizeof(Posting);
+		}
+		header.stringsOffset = header.termsOffset + termTable.size() * sizeof(PdfIndex::Term);
+		header.postingsOffset = (header.stringsOffset + strings.size() + 7) & ~uint64_t(7);
+
+		std::vector<PdfIndex::Suffix> suffixes;
+		for (uint32_t t = 0; t < sortedTerms.size(); ++t)
+			for (uint32_t o = 0; o < sortedTerms[t]->size(); ++o)
+				suffixes.push_back(PdfIndex::Suffix{ t, o });
+		algo::parallel_sort(suffixes, [&](const PdfIndex::Suffix& a, const PdfIndex::Suffix& b) {
+			return std::string_view(*sortedTerms[a.term]).substr(a.offset) < std::string_view(*sortedTerms[b.term]).substr(b.offset);
+		});
+		header.suffixCount = suffixes.size();
+		header.suffixesOffset = header.postingsOffset + postingBytes; // postings keep it 8 byte aligned
+		for (auto& e : entries) e.pathOffset += header.stringsOffset;
+		for (auto& t : termTable) {
+			t.textOffset += header.stringsOffset;
+			t.postingsOffset += header.postingsOffset;
+		}
+
+		fs::path tmp = pdf::temp_path(indexPath);
+		std::error_code ec;
+		{
+			std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+			if (!out) return false;
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PdfIndex::Entry));
+			out.write(reinterpret_cast<const char*>(termTable.data()), termTable.size() * sizeof(PdfIndex::Term));
+			out.write(strings.data(), strings.size());
+			static const char pad[8] = {};
+			out.write(pad, header.postingsOffset - header.stringsOffset - strings.size());
+			for (auto t : sortedTerms) {
+				const auto& list = postings[*t];
+				out.write(reinterpret_cast<const char*>(list.data()), list.size() * sizeof(Posting));
+			}
+			out.write(reinterpret_cast<const char*>(suffixes.data()), suffixes.size() * sizeof(PdfIndex::Suffix));
+			if (!out) {
+				out.close();
+				fs::remove(tmp, ec);
+				return false;
+			}
+		}
+		fs::rename(tmp, indexPath, ec);
+		if (ec) {
+			fs::remove(tmp, ec);
+			return false;
+		}
+		stats.terms = sortedTerms.size();
+		return true;
+	}
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+	const char* ptr = nullptr;
+	size_t len = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#endif
+
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile() { close(); }
+
+	bool open(const fs::path& path) {
+		close();
+	#ifdef _WIN32
+		file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) { close(); return false; }
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) { close(); return false; }
+		ptr = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!ptr) { close(); return false; }
+		len = size_t(size.QuadPart);
+	#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+		void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd); // the mapping keeps its own reference
+		if (p == MAP_FAILED) return false;
+		ptr = static_cast<const char*>(p);
+		len = size_t(st.st_size);
+	#endif
+		return true;
+	}
+
+	void close() {
+	#ifdef _WIN32
+		if (ptr) UnmapViewOfFile(ptr);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+	#else
+		if (ptr) munmap(const_cast<char*>(ptr), len);
+	#endif
+		ptr = nullptr;
+		len = 0;
+	}
+
+	// Tells the kernel the whole mapping is needed soon, so read-ahead starts right away.
+	// Not MADV_SEQUENTIAL: Poppler starts at the xref table at the end and then jumps between objects.
+	void adviseWillNeed() const {
+	#ifndef _WIN32
+		if (ptr) madvise(const_cast<char*>(ptr), len, MADV_WILLNEED);
+	#endif
+	}
+
+	const char* data() const { return ptr; }
+	size_t size() const { return len; }
+	bool isOpen() const { return ptr != nullptr; }
+};
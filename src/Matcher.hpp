@@ -0,0 +1,156 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// ASCII case-insensitive substring search, built once from the lowercase needle.
+// Searches a buffer in place without allocating: a SIMD prefilter on the first and last
+// needle byte finds candidates which are then verified case-folded.
+// Without SIMD it falls back to Boyer-Moore-Horspool on folded bytes.
+class Matcher {
+	std::string needle; // lowercase
+	unsigned char fold[256];
+	size_t shift[256];
+
+	bool equalsAt(const char* p) const {
+		for (size_t k = 0; k < needle.size(); ++k)
+			if (fold[(unsigned char)p[k]] != (unsigned char)needle[k]) return false;
+		return true;
+	}
+
+	size_t find_scalar(const char* hay, size_t n, size_t i) const {
+		const size_t m = needle.size();
+		const unsigned char lastc = (unsigned char)needle[m - 1];
+		while (i + m <= n) {
+			unsigned char c = fold[(unsigned char)hay[i + m - 1]];
+			if (c == lastc && equalsAt(hay + i))
+				return i;
+			i += shift[c];
+		}
+		return std::string_view::npos;
+	}
+
+public:
+	explicit Matcher(const std::string& needleLower = std::string()) : needle(needleLower) {
+		for (int c = 0; c < 256; ++c)
+			fold[c] = (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : (unsigned char)c;
+		for (auto& c : needle)
+			c = (char)fold[(unsigned char)c];
+
+		const size_t m = needle.size();
+		for (auto& s : shift) s = m ? m : 1;
+		for (size_t k = 0; k + 1 < m; ++k)
+			shift[(unsigned char)needle[k]] = m - 1 - k;
+	}
+
+	const std::string& pattern() const { return needle; }
+	size_t size() const { return needle.size(); }
+
+	// find() without the SIMD prefilter, as builds without SIMD run it
+	size_t find_scalar(std::string_view hay, size_t from = 0) const {
+		const size_t m = needle.size();
+		if (m == 0) return from <= hay.size() ? from : std::string_view::npos;
+		if (from >= hay.size() || hay.size() - from < m) return std::string_view::npos;
+		return find_scalar(hay.data(), hay.size(), from);
+	}
+
+	// Offset of the first match in hay at or after from, npos if there is none
+	size_t find(std::string_view hay, size_t from = 0) const {
+		const size_t m = needle.size();
+		const size_t n = hay.size();
+		if (m == 0) return from <= n ? from : std::string_view::npos;
+		if (from >= n || n - from < m) return std::string_view::npos;
+		const char* h = hay.data();
+		size_t i = from;
+
+	#if defined(__AVX2__) || defined(__SSE2__) || defined(__ARM_NEON)
+		// Letters match both cases by comparing with bit 0x20 set, other bytes compare exactly
+		const unsigned char f = (unsigned char)needle[0], l = (unsigned char)needle[m - 1];
+		const unsigned char fmask = (f >= 'a' && f <= 'z') ? 0x20 : 0;
+		const unsigned char lmask = (l >= 'a' && l <= 'z') ? 0x20 : 0;
+	#endif
+
+	#if defined(__AVX2__)
+		const __m256i vf = _mm256_set1_epi8((char)f), vl = _mm256_set1_epi8((char)l);
+		const __m256i mf = _mm256_set1_epi8((char)fmask), ml = _mm256_set1_epi8((char)lmask);
+		for (; i + m - 1 + 32 <= n; i += 32) {
+			__m256i a = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(h + i)), mf);
+			__m256i b = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(h + i + m - 1)), ml);
+			uint32_t bits = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, vf), _mm256_cmpeq_epi8(b, vl)));
+			while (bits) {
+				int k = __builtin_ctz(bits);
+				if (equalsAt(h + i + k)) return i + k;
+				bits &= bits - 1;
+			}
+		}
+	#elif defined(__SSE2__)
+		const __m128i vf = _mm_set1_epi8((char)f), vl = _mm_set1_epi8((char)l);
+		const __m128i mf = _mm_set1_epi8((char)fmask), ml = _mm_set1_epi8((char)lmask);
+		for (; i + m - 1 + 16 <= n; i += 16) {
+			__m128i a = _mm_or_si128(_mm_loadu_si128((const __m128i*)(h + i)), mf);
+			__m128i b = _mm_or_si128(_mm_loadu_si128((const __m128i*)(h + i + m - 1)), ml);
+			unsigned bits = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, vf), _mm_cmpeq_epi8(b, vl)));
+			while (bits) {
+				int k = __builtin_ctz(bits);
+				if (equalsAt(h + i + k)) return i + k;
+				bits &= bits - 1;
+			}
+		}
+	#elif defined(__ARM_NEON)
+		const uint8x16_t vf = vdupq_n_u8(f), vl = vdupq_n_u8(l);
+		const uint8x16_t mf = vdupq_n_u8(fmask), ml = vdupq_n_u8(lmask);
+		for (; i + m - 1 + 16 <= n; i += 16) {
+			uint8x16_t a = vorrq_u8(vld1q_u8((const uint8_t*)(h + i)), mf);
+			uint8x16_t b = vorrq_u8(vld1q_u8((const uint8_t*)(h + i + m - 1)), ml);
+			uint8x16_t eq = vandq_u8(vceqq_u8(a, vf), vceqq_u8(b, vl));
+			// Narrow to 4 bits per byte to get a scannable mask
+			uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+			while (bits) {
+				int k = __builtin_ctzll(bits) >> 2;
+				if (equalsAt(h + i + k)) return i + k;
+				bits &= ~(uint64_t(0xF) << (k * 4));
+			}
+		}
+	#endif
+		return find_scalar(h, n, i);
+	}
+};
+
+// Finds hits of one or more patterns in page text.
+// Implementations are immutable after construction and shared by all search threads.
+struct PageMatcher {
+	// Receives (offset, length, pattern) of a hit and returns the offset to continue searching from.
+	// Hits starting before that offset may be skipped, returning the hit offset itself skips nothing.
+	using HitFunc = std::function<size_t(size_t, size_t, int)>;
+
+	virtual ~PageMatcher() = default;
+	virtual size_t patternCount() const = 0;
+	virtual void scan(std::string_view text, const HitFunc& hit) const = 0;
+};
+
+// Single pattern, backed by Matcher
+class LiteralPageMatcher : public PageMatcher {
+	Matcher matcher;
+public:
+	explicit LiteralPageMatcher(const std::string& needleLower) : matcher(needleLower) {}
+
+	size_t patternCount() const override { return 1; }
+	void scan(std::string_view text, const HitFunc& hit) const override {
+		size_t pos = matcher.find(text);
+		while (pos != std::string_view::npos) {
+			size_t next = std::max(hit(pos, matcher.size(), 0), pos + 1);
+			pos = matcher.find(text, next);
+		}
+	}
+};
@@ -2,147 +2,473 @@
 
 #include "SearchedFiles.hpp"
 #include "util.hpp"
+#include "HeldOutput.hpp"
 
+#include <deque>
+#include <map>
+
+// Incremental result display. Results are shown in the order files were opened, each as two lines:
+// the file name and its pages. The front results are final once completed and scroll away, the ones
+// behind them stay live at the bottom together with the progress line.
+// Each frame only consumes the occurrences that are new since the previous one and redraws from the
+// first live result that changed; frames are woken by SearchedFiles::notifyUpdate and coalesced to fps.
+// The other formats stream completed results without redrawing, for pipes and files, and release them once written.
+// Results --sort holds back are formatted once they complete and kept as HeldOutput, not as occurrences.
+// With --top nothing is written before the end, then the files SearchedFiles::top kept in rank order.
 struct OutThread {
+	enum class Format {
+		terminal, // live redraw with progress line
+		text,     // the same two lines per file, written once the file completed
+		json,     // one array of occurrence objects
+		ndjson,   // one occurrence object per line
+	};
+
+	enum class Sort {
+		none, // completion order, or opening order on the terminal
+		path, // streamed in path order, a file is written once all files before it completed
+		hits, // most occurrences first, written at the end
+	};
+
 	SearchedFiles* sf;
+	Format format = Format::terminal;
+	Sort sort = Sort::none; // streaming formats only
+	bool files_only = false; // -l: one line with the path per matching file
+	bool print_line = false; // --printline, -A/-B/-C: the lines of a file below its pages, once it completed
+	bool print_path = false; // --printpath: the directory after the file name
+	int fps = 10; // redraws per second at most
+	double busy_time = 0; // seconds spent building and writing the display, for --stats
+	FILE* output = stdout; // of the streaming formats
 	OutThread(SearchedFiles* sf) : sf(sf) {}
 
-	void print() {
-		// --- Main Display Logic (Block Update) ---
-		size_t idx_startUnprinted = 0; // Tracks the first file that is not yet finalized.
-		size_t lastPrintedResultCount = 0; // How many *results* (each 2 lines) were displayed in the *previous* refresh.
-
-		auto allPrinted = [&]() -> bool {
-			std::lock_guard<std::mutex> lock(sf->results_mutex);
-			for (int i=0;i<sf->results.size();++i) {
-				auto r = sf->results[i];
-				if (r && !r->getPrinted())
-					return false;
-			}
-			return true;
+	// Display state of a result that is not final yet
+	struct LiveResult {
+		SearchResult* res;
+		size_t seen = 0; // occurrences already merged into pages
+		bool completed = false; // as of the last merge, all occurrences are seen then
+		std::vector<std::vector<int>> pages; // sorted and unique, per pattern or one list for a single pattern
+		std::string text; // both lines (the path only with -l), each ending with a newline
+		int rows = 0; // rows it takes on screen, 0 while not shown
+		bool dirty = false;
+	};
+
+	std::deque<LiveResult> live; // results from first_live on
+	size_t first_live = 0;
+	int width = 80;
+	int shown_rows = 0; // rows of the live results plus the progress line currently on screen
+
+	// Merges new occurrences, returns true if a page was added
+	bool merge(LiveResult& l) {
+		// Completed is read before the count, so a completed result is seen with all its occurrences
+		l.completed = l.res->getCompleted();
+		size_t count = l.res->occurrenceCount();
+		bool changed = false;
+		if (l.pages.empty())
+			l.pages.resize(sf->searchWords.size() > 1 ? sf->searchWords.size() : 1);
+		for (; l.seen < count; ++l.seen) {
+			const Occurence& occ = l.res->occurrence(l.seen);
+			auto& pages = l.pages[l.pages.size() > 1 ? occ.pattern : 0];
+			auto it = std::lower_bound(pages.begin(), pages.end(), occ.page);
+			if (it != pages.end() && *it == occ.page) continue;
+			pages.insert(it, occ.page); // pages mostly arrive in order, so this appends
+			changed = true;
+		}
+		return changed;
+	}
+
+	static void append_pages(std::string& out, const std::vector<int>& pages) {
+		for (size_t j = 0; j < pages.size(); ++j) {
+			if (j > 0) out += ", ";
+			out += std::to_string(pages[j]);
+		}
+	}
+
+	// Context lines as stored (before ends with a line break, after starts with one), one view per line
+	static std::vector<std::string_view> context_lines(std::string_view s, bool after) {
+		std::vector<std::string_view> lines;
+		if (s.empty()) return lines;
+		if (after) s.remove_prefix(1);
+		else s.remove_suffix(1);
+		for (size_t start = 0;;) {
+			size_t nl = std::min(s.find('\n', start), s.size());
+			lines.push_back(s.substr(start, nl - start));
+			if (nl == s.size()) break;
+			start = nl + 1;
+		}
+		return lines;
+	}
+
+	// Lines of a completed result grep style with the page in front: "page:line:text" for hits, "page-line-text"
+	// for context and "--" between context groups that aren't adjacent. A line is printed once for all its hits.
+	static void append_lines(std::string& out, const SearchResult& res) {
+		struct Line {
+			std::string_view text;
+			bool hit;
 		};
+		std::map<std::pair<int, int>, Line> lines; // by page and line number
+		for (size_t k = 0; k < res.occurrenceCount(); ++k) {
+			const Occurence& occ = res.sortedOccurrence(k);
+			lines[{ occ.page, occ.line_number }] = Line{ occ.line(), true };
+			auto before = context_lines(res.sortedBefore(k), false);
+			for (size_t j = 0; j < before.size(); ++j)
+				lines.emplace(std::make_pair(occ.page, occ.line_number - int(before.size() - j)), Line{ before[j], false });
+			auto after = context_lines(res.sortedAfter(k), true);
+			for (size_t j = 0; j < after.size(); ++j)
+				lines.emplace(std::make_pair(occ.page, occ.line_number + 1 + int(j)), Line{ after[j], false });
+		}
+		std::pair<int, int> previous{ 0, 0 };
+		for (const auto& [at, line] : lines) {
+			if (res.hasContext() && previous.first && (at.first != previous.first || at.second != previous.second + 1))
+				out += "\t--\n";
+			const char sep = line.hit ? ':' : '-';
+			out += "\t" + std::to_string(at.first) + sep + std::to_string(at.second) + sep;
+			out += line.text;
+			out += "\n";
+			previous = at;
+		}
+	}
 
-	#if 1 // old
-		std::mutex printMutex;
-		bool progress_printed = false;
-		int completed_last_iter = 0;
-		while (!sf->aborted && (sf->completed_files < sf->total_files || !allPrinted())) {
-			// Wait for a short period or until notified that new results are available.
-			std::unique_lock<std::mutex> printLock(printMutex);
-			sf->queue_cv.wait_for(printLock, std::chrono::milliseconds(200), [&]() {
-				//float progress = float(completed_files)*100./total_files;
-				//std::cout << std::setw(5)
-				//		  << std::fixed << std::setprecision(1)
-				//		  << progress << "%\n" << std::flush;
-				//delete_last_lines(1);
-				return true;
-			});
+	void format_result(LiveResult& l) {
+		if (files_only) {
+			l.text = l.res->getPdfPath().string() + "\n";
+			return;
+		}
+		// --- Line 1: Filename and optional path ---
+		l.text = l.res->getPdfPath().filename().string();
+		if (print_path)
+			l.text += "\t" + l.res->getPdfPath().parent_path().string();
+		l.text += "\n";
 
-			if (progress_printed)
-				terminal::delete_last_lines(1); // print progress
-			//assert(lastPrintedResultCount >= completed_last_iter);
-			terminal::delete_last_lines((lastPrintedResultCount-completed_last_iter));
+		// --- Line 2: Tab followed by pages ---
+		std::string line2 = "	";
+		if (l.pages.size() > 1) {
+			// Pages per pattern that hit
+			for (size_t p = 0; p < l.pages.size(); ++p) {
+				if (l.pages[p].empty()) continue;
+				if (line2.size() > 1) line2 += "	";
+				line2 += sf->searchWords[p] + ": ";
+				append_pages(line2, l.pages[p]);
+			}
+		} else {
+			append_pages(line2, l.pages[0]);
+		}
+		l.text += line2 + "\n";
+
+		// --- Lines, once their page order is known ---
+		if (print_line && l.completed)
+			append_lines(l.text, *l.res);
+	}
+
+	int rows_of(const LiveResult& l) const {
+		int rows = 0;
+		for (size_t start = 0, end; start < l.text.size(); start = end + 1) {
+			end = l.text.find('\n', start);
+			rows += terminal::display_rows(l.text.substr(start, end - start), width);
+		}
+		return rows;
+	}
+
+	std::string progress_line() const {
+		std::ostringstream line;
+		if (sf->walk_done) {
+			float progress = sf->total_files ? float(sf->completed_files)*100./sf->total_files : 100.f;
+			line << std::setw(5) << std::fixed << std::setprecision(1) << progress << "%";
+		} else { // total still growing
+			line << sf->completed_files << "/" << sf->total_files << "+ files";
+		}
+		return line.str();
+	}
 
-			//if (lastPrintedResultCount > 0 && completed_last_iter > 0 && lastPrintedResultCount == completed_last_iter)
-			//	std::cout << "break\n";
-			//std::cout << "would deleting " << lastPrintedResultCount << " - " << completed_last_iter << " x2 lines\n";
-			completed_last_iter = 0;
-			size_t printedResultCount = 0; // Reset count for results printed in this cycle
+	void render() {
+		bool resized = false;
+		if (terminal::consume_resize()) {
+			int w = terminal::getConsoleWidth();
+			resized = w != width;
+			width = w;
+		}
 
-			std::stringstream buf;
-			bool startIncompleteSet = false;
+		// --- Pick up new results and occurrences ---
+		for (size_t i = first_live + live.size(); i < sf->results.size(); ++i)
+			live.push_back(LiveResult{ sf->results[i].get() });
+		size_t first_dirty = live.size();
+		for (size_t i = 0; i < live.size(); ++i) {
+			LiveResult& l = live[i];
+			bool was_completed = l.completed;
+			if (merge(l) || (print_line && l.completed && !was_completed)) {
+				format_result(l);
+				l.dirty = true;
+			}
+			if (l.completed && l.res->getDropped() && !l.text.empty()) {
+				l.text.clear(); // cut short, take it off the screen again
+				l.dirty = true;
+			}
+			if ((l.dirty || (resized && l.rows)) && first_dirty == live.size())
+				first_dirty = i;
+		}
 
-			int count = 0;
-			{ //  dont lock for whole duration to avoid blocking search threads
-				std::lock_guard<std::mutex> lock(sf->results_mutex);
-				count = sf->results.size();
+		// --- Redraw from the first changed result, everything above stays on screen ---
+		int keep_rows = 0;
+		for (size_t i = 0; i < first_dirty; ++i)
+			keep_rows += live[i].rows;
+		std::string buf;
+		int rows = keep_rows;
+		for (size_t i = first_dirty; i < live.size(); ++i) {
+			LiveResult& l = live[i];
+			l.dirty = false;
+			if (l.text.empty()) { // no occurrences yet
+				l.rows = 0;
+				continue;
 			}
-			for (int i = idx_startUnprinted; i < count; ++i) {
+			l.rows = rows_of(l);
+			rows += l.rows;
+			buf += l.text;
+		}
+		std::string progress = progress_line();
+		rows += terminal::display_rows(progress, width);
+		buf += progress + "\n";
 
-				std::shared_ptr<SearchResult> res;
-				bool completed;
-				{
-					std::unique_lock<std::mutex> lock(sf->results_mutex);
-					res = sf->results[i];
-				}
-				completed = res->getCompleted();
-
-				auto occurences = res->getOccurences();
-				if (completed && occurences.size()==0) {
-						res->setPrinted(true);
-						continue;
-					}
-				else if (!completed && occurences.size()==0) {
-					continue;
-				}
+		terminal::clear_last_lines(shown_rows - keep_rows);
+		std::cout << buf << std::flush;
+		shown_rows = rows;
+
+		// --- Completed results at the front are final now ---
+		while (!live.empty() && live.front().completed) {
+			shown_rows -= live.front().rows;
+			live.pop_front();
+			sf->results[first_live++].reset(); // its lines stay on screen, its occurrences can go
+		}
+	}
 
-				std::vector<int> display_pages;
-				for (const auto& occ : occurences)
-					display_pages.push_back(occ.page);
-				std::sort(display_pages.begin(), display_pages.end());
-				display_pages.erase(std::unique(display_pages.begin(), display_pages.end()), display_pages.end());
-
-				{ // printing
-					res->setPrintingHeight(0);
-					int consoleWidth = terminal::getConsoleWidth();
-					
-					// --- Line 1: Filename and optional path ---
-					std::string line1_content = res->getPdfPath().filename().string();
-
-					//TODO was arg, reimpl later
-					//if (print_path) {
-					//	line1_content += "	" + res->getPdfPath().parent_path().string();
-					//}
-					
-					int wrapped_lines_1 = (line1_content.length() + consoleWidth - 1) / consoleWidth;
-					
-					buf << line1_content << "\n";
-					printedResultCount += wrapped_lines_1;
-					int resPh = wrapped_lines_1;
-					
-					// --- Line 2: Tab followed by pages ---
-					std::string line2_content = "	"; // Start with the tab
-					for (size_t j = 0; j < display_pages.size(); ++j) {
-						if (j > 0) line2_content += ", ";
-						line2_content += std::to_string(display_pages[j]);
-					}
-					
-					int wrapped_lines_2 = (line2_content.length() + consoleWidth - 1) / consoleWidth;
-					
-					buf << line2_content << "\n";
-					printedResultCount += wrapped_lines_2;
-					resPh += wrapped_lines_2;
-					res->setPrintingHeight(res->getPrintingHeight()+resPh);
+	// --- Streaming formats ---
+
+	static constexpr size_t flush_bytes = size_t(1) << 16;
+
+	// A reader that went away (a closed pipe or socket) stops the search
+	void write_out(std::string& out) {
+		if (std::fwrite(out.data(), 1, out.size(), output) != out.size() || std::fflush(output) != 0)
+			sf->aborted = true;
+		out.clear();
+	}
+
+	// Appends a completed result, first tells whether a JSON record was written before
+	void write_result(std::string& out, SearchResult& res, bool& first) {
+		size_t count = res.occurrenceCount();
+		if (count == 0 || res.getDropped()) return;
+		if (format == Format::text) {
+			LiveResult l{ &res };
+			merge(l);
+			format_result(l);
+			out += l.text;
+			return;
+		}
+		const std::string file = json::quote(res.getPdfPath().u8string());
+		for (size_t k = 0; k < count; ++k) {
+			const Occurence& occ = res.sortedOccurrence(k);
+			if (format == Format::json)
+				out += first ? "\n" : ",\n";
+			first = false;
+			out += "{\"file\": " + file + ", \"page\": " + std::to_string(occ.page) + ", \"line_number\": " + std::to_string(occ.line_number)
+				+ ", \"line\": " + json::quote(occ.line());
+			if (sf->searchWords.size() > 1)
+				out += ", \"pattern\": " + json::quote(sf->searchWords[occ.pattern]);
+			if (res.hasContext()) {
+				const char* key = ", \"before\": [";
+				for (bool after : { false, true }) {
+					out += key;
+					auto lines = context_lines(after ? res.sortedAfter(k) : res.sortedBefore(k), after);
+					for (size_t j = 0; j < lines.size(); ++j)
+						out += (j ? ", " : "") + json::quote(lines[j]);
+					out += "]";
+					key = ", \"after\": [";
 				}
+			}
+			out += format == Format::ndjson ? "}\n" : "}";
+		}
+	}
+
+	std::string out;
+	bool first_record = true;
+	size_t next_result = 0; // results not looked at yet
+	std::vector<size_t> pending; // indices of results seen but not completed
+	static constexpr size_t not_held = ~size_t(0);
+	std::vector<size_t> by_file; // Sort::path: held block per file index
+	size_t next_file = 0; // Sort::path: files before it are written
+	struct Ranked {
+		size_t count;
+		fs::path path;
+		size_t block;
+	};
+	std::vector<Ranked> ranked; // Sort::hits: held results
+	HeldOutput held; // --sort-memory sets its budget
+
+	void write_released(size_t i) {
+		write_result(out, *sf->results[i], first_record);
+		sf->results[i].reset(); // nobody looks at a written result again, its occurrences can go
+	}
+
+	// A block formatted on its own is formatted as the first record, for JSON only the separator before it differs
+	void write_held(size_t block) {
+		const bool comma = format == Format::json && !first_record;
+		if (comma) out += ',';
+		size_t start = out.size();
+		held.take(block, out);
+		if (out.size() == start) {
+			if (comma) out.pop_back();
+			return;
+		}
+		first_record = false;
+	}
+
+	// Formats a completed result that is written later and releases it
+	size_t hold(size_t i) {
+		std::string block;
+		bool first = true;
+		write_result(block, *sf->results[i], first);
+		sf->results[i].reset();
+		return held.add(std::move(block));
+	}
 
-				if (completed && !startIncompleteSet) {
-					res->setPrinted(true);
+	void write_completed() {
+		for (; next_result < sf->results.size(); ++next_result)
+			pending.push_back(next_result);
+		size_t kept = 0;
+		for (size_t i : pending) {
+			SearchResult& res = *sf->results[i];
+			if (!res.getCompleted()) {
+				pending[kept++] = i;
+			} else if (sf->top) {
+				sf->results[i].reset(); // the top keeps the files it ranks, the rest is gone with this
+			} else if (sort == Sort::none) {
+				write_released(i);
+			} else if (sort == Sort::hits) {
+				if (!res.getDropped() && res.occurrenceCount() > 0) {
+					Ranked r{ res.occurrenceCount(), res.getPdfPath() };
+					r.block = hold(i);
+					ranked.push_back(std::move(r));
+				} else {
+					sf->results[i].reset();
 				}
-				else if (!startIncompleteSet) {
-					startIncompleteSet = true;
+			} else {
+				size_t f = res.getFileIndex();
+				if (f >= by_file.size()) by_file.resize(f + 1, not_held);
+				if (f == next_file) {
+					write_released(i);
+					next_file++;
+				} else {
+					by_file[f] = hold(i);
 				}
 			}
-			lastPrintedResultCount = printedResultCount;
+		}
+		pending.resize(kept);
+		if (sort == Sort::path)
+			for (; next_file < by_file.size() && by_file[next_file] != not_held; ++next_file)
+				write_held(by_file[next_file]);
+	}
+
+	// After the search threads were joined: what is left, in the requested order
+	void write_rest() {
+		write_completed();
+		if (sf->top) {
+			for (auto& e : sf->top->take()) {
+				write_result(out, *e.result, first_record);
+				e.result.reset();
+				if (out.size() >= flush_bytes) write_out(out);
+			}
+			return;
+		}
+		if (sort == Sort::path) {
+			// Only an abort leaves gaps, the files behind them still come in path order
+			for (; next_file < by_file.size(); ++next_file)
+				if (by_file[next_file] != not_held)
+					write_held(by_file[next_file]);
+			return;
+		}
+		if (sort == Sort::hits) {
+			algo::parallel_sort(ranked, [](const Ranked& a, const Ranked& b) {
+				if (a.count != b.count) return a.count > b.count;
+				return a.path < b.path;
+			});
+			for (const Ranked& r : ranked) {
+				write_held(r.block);
+				if (out.size() >= flush_bytes) write_out(out); // spilled blocks are read back one at a time
+			}
+			ranked.clear();
+		}
+	}
+
+	// Writes results in the order they complete through one large buffer, flushed when full or every 100 ms
+	void stream() {
+		out.reserve(flush_bytes * 2);
+		if (format == Format::json) out += "[";
+		uint64_t seen_updates = ~uint64_t(0);
+		auto last_flush = std::chrono::steady_clock::now();
+		std::mutex wait_mutex;
 
+		while (!sf->aborted) {
 			{
-				std::unique_lock<std::mutex> lock(sf->results_mutex);
-				while (idx_startUnprinted < sf->results.size() && sf->results[idx_startUnprinted]->getPrinted()) {
-					if (sf->results[idx_startUnprinted]->getOccurences().size() > 0 && idx_startUnprinted)
-						completed_last_iter += sf->results[idx_startUnprinted]->getPrintingHeight();
-					idx_startUnprinted++;
-				}
+				std::unique_lock<std::mutex> lock(wait_mutex);
+				sf->queue_cv.wait_for(lock, std::chrono::milliseconds(100), [&]() {
+					return sf->aborted || sf->updates.load(std::memory_order_acquire) != seen_updates;
+				});
+			}
+			auto write_start = std::chrono::steady_clock::now();
+			seen_updates = sf->updates.load(std::memory_order_acquire);
+			bool finished = sf->walk_done && sf->completed_files >= sf->total_files;
+
+			write_completed();
+
+			auto now = std::chrono::steady_clock::now();
+			if (out.size() >= flush_bytes || (!out.empty() && now - last_flush >= std::chrono::milliseconds(100))) {
+				write_out(out);
+				last_flush = now;
 			}
+			busy_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - write_start).count();
+			if (finished) break;
+		}
+	}
+
+	// Shows results as they come in, returns when all files completed or the search was aborted
+	void print() {
+		if (format != Format::terminal) {
+			stream();
+			return;
+		}
+		terminal::watch_resize();
+		const auto frame = std::chrono::milliseconds(1000 / std::max(1, fps));
+		auto last_frame = std::chrono::steady_clock::now() - frame;
+		uint64_t drawn_updates = ~uint64_t(0);
+		std::mutex wait_mutex;
 
-			float progress = float(sf->completed_files)*100./sf->total_files;
-			buf << std::setw(5)
-					  << std::fixed << std::setprecision(1)
-					  << progress << "%\n" << std::flush;
+		while (!sf->aborted) {
+			// Sleep until something changed. Notifications aren't synchronized with this wait, the timeout bounds a missed one.
+			{
+				std::unique_lock<std::mutex> lock(wait_mutex);
+				sf->queue_cv.wait_for(lock, std::chrono::milliseconds(250), [&]() {
+					return sf->aborted || sf->updates.load(std::memory_order_acquire) != drawn_updates;
+				});
+			}
+			// Coalesce everything that arrives within one frame
+			std::this_thread::sleep_until(last_frame + frame);
+			if (sf->aborted) break;
 
-			std::cout << buf.str();
-			progress_printed = true;
+			auto draw_start = std::chrono::steady_clock::now();
+			last_frame = draw_start;
+			drawn_updates = sf->updates.load(std::memory_order_acquire);
+			// Checked before drawing: every file completed by now is shown by this frame
+			bool finished = sf->walk_done && sf->completed_files >= sf->total_files;
+			render();
+			busy_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - draw_start).count();
+			if (finished) break;
 		}
-	#else
-	#endif
+	}
 
+	// Final output once the search threads were joined, picks up what completed after an abort
+	void finish() {
+		if (format == Format::terminal) {
+			render();
+			return;
+		}
+		write_rest();
+		if (format == Format::json) out += first_record ? "]\n" : "\n]\n";
+		write_out(out);
 	}
 };
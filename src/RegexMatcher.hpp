@@ -0,0 +1,125 @@
+#pragma once
+
+#include "AhoCorasick.hpp"
+
+#include <re2/re2.h>
+#include <re2/filtered_re2.h>
+
+#include <memory>
+
+// Regular expressions on RE2, which matches in linear time in the page size. Compiled once and shared
+// read-only by all search threads, like the other matchers.
+// The literals every match has to contain (FilteredRE2 atoms) are searched first with Matcher or the
+// Aho-Corasick automaton; only the patterns whose literals occur on the page are run, most pages never
+// reach RE2. Patterns without usable literals (e.g. "\d+") run on every page.
+// Case-insensitive and line oriented like the literal search: ^ and $ match at line breaks, . doesn't match one.
+class RegexPageMatcher : public PageMatcher {
+	re2::FilteredRE2 filter{ 2 }; // atoms shorter than 2 bytes don't filter anything
+	std::vector<std::string> atoms; // lowercase
+	std::unique_ptr<PageMatcher> atomMatcher; // null if there is nothing to prefilter with
+	size_t patterns = 0;
+	std::string err;
+
+	static RE2::Options options() {
+		RE2::Options opt;
+		opt.set_log_errors(false);
+		opt.set_case_sensitive(false);
+		// Perl syntax, but with multi-line ^ and $
+		opt.set_posix_syntax(true);
+		opt.set_perl_classes(true);
+		opt.set_word_boundary(true);
+		opt.set_one_line(false);
+		return opt;
+	}
+
+	// Next match of pattern p at or after from
+	struct Cursor {
+		int pattern;
+		size_t offset, length;
+	};
+
+	bool next(std::string_view text, int p, size_t from, Cursor& c) const {
+		if (from > text.size()) return false;
+		re2::StringPiece input(text.data(), text.size()), m;
+		if (!filter.GetRE2(p).Match(input, from, text.size(), RE2::UNANCHORED, &m, 1))
+			return false;
+		c = Cursor{ p, size_t(m.data() - text.data()), size_t(m.size()) };
+		return true;
+	}
+
+public:
+	explicit RegexPageMatcher(const std::vector<std::string>& regexes) {
+		for (const auto& r : regexes) {
+			int id;
+			if (filter.Add(r, options(), &id) != RE2::NoError) {
+				err = "Invalid regular expression \"" + r + "\": " + RE2(r, options()).error();
+				return;
+			}
+		}
+		patterns = regexes.size();
+		filter.Compile(&atoms);
+
+		// The prefilter folds ASCII only, atoms with other letters could miss their uppercase forms
+		bool ascii = true;
+		for (const auto& a : atoms)
+			for (unsigned char c : a)
+				ascii = ascii && c < 0x80;
+		if (!ascii || atoms.empty()) return;
+		if (atoms.size() == 1)
+			atomMatcher = std::make_unique<LiteralPageMatcher>(atoms[0]);
+		else
+			atomMatcher = std::make_unique<AhoCorasickMatcher>(atoms);
+	}
+
+	// Empty if all patterns compiled
+	const std::string& error() const { return err; }
+
+	size_t patternCount() const override { return patterns; }
+
+	// Hits of all patterns are reported in order of their offset, each pattern's matches don't overlap
+	void scan(std::string_view text, const HitFunc& hit) const override {
+		// --- Which patterns can match at all ---
+		std::vector<int> candidates;
+		if (atomMatcher) {
+			std::vector<int> found;
+			std::vector<bool> seen(atoms.size());
+			atomMatcher->scan(text, [&](size_t pos, size_t, int a) -> size_t {
+				if (!seen[a]) {
+					seen[a] = true;
+					found.push_back(a);
+				}
+				return found.size() == atoms.size() ? text.size() : pos; // stop once every atom was seen
+			});
+			filter.AllPotentials(found, &candidates);
+			if (candidates.empty()) return;
+			std::sort(candidates.begin(), candidates.end());
+		} else {
+			for (size_t p = 0; p < patterns; ++p) candidates.push_back(int(p));
+		}
+
+		// --- Merge the matches of the candidates by offset ---
+		std::vector<Cursor> cursors;
+		for (int p : candidates) {
+			Cursor c;
+			if (next(text, p, 0, c)) cursors.push_back(c);
+		}
+		while (!cursors.empty()) {
+			size_t first = 0;
+			for (size_t k = 1; k < cursors.size(); ++k)
+				if (cursors[k].offset < cursors[first].offset) first = k;
+			const Cursor c = cursors[first];
+			size_t resume = hit(c.offset, c.length, c.pattern);
+			size_t kept = 0;
+			for (size_t k = 0; k < cursors.size(); ++k) {
+				Cursor& other = cursors[k];
+				bool more = true;
+				if (k == first) // behind this match, empty matches advance by one
+					more = next(text, c.pattern, std::max(resume, c.offset + std::max<size_t>(c.length, 1)), other);
+				else if (other.offset < resume)
+					more = next(text, other.pattern, resume, other);
+				if (more) cursors[kept++] = other;
+			}
+			cursors.resize(kept);
+		}
+	}
+};
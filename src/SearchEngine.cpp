@@ -0,0 +1,166 @@
+#include "SearchEngine.hpp"
+
+SearchEngine::SearchEngine(const Options& options) : opts(options) {
+	fs::path cache_dir = opts.cache_dir.empty() ? pdf::default_cache_dir() : opts.cache_dir;
+	if (opts.use_cache || opts.memory_cache)
+		cache = std::make_shared<TextCache>(opts.use_cache ? cache_dir : fs::path(), opts.memory_cache);
+}
+
+std::unique_ptr<SearchEngine::Search> SearchEngine::start(Query query, std::string& error) {
+	auto search = std::make_unique<Search>();
+	SearchedFiles& sf = search->files;
+	SearchThreads& st = search->threads;
+	sf.searchWords = std::move(query.patterns);
+	sf.textCache = cache;
+	st.thread_pool = &pool;
+	st.num_threads = opts.threads;
+	st.num_readers = opts.readers;
+	st.num_matchers = opts.matchers;
+	st.read_queue_depth = opts.read_queue_depth;
+	st.match_queue_depth = opts.match_queue_depth;
+	st.use_mmap = opts.use_mmap;
+	st.pin = opts.pin;
+	st.file_timeout = opts.file_timeout;
+	st.max_pages = opts.max_pages;
+	st.max_count = query.max_count;
+	st.limit = query.limit;
+	st.max_line = query.max_line;
+	st.before_context = query.before_context;
+	st.after_context = query.after_context;
+	st.region = query.region;
+	st.regex = query.regex;
+	st.normalize = query.normalize;
+	st.join_lines = query.join_lines;
+	if (query.top && query.rank == Rank::bm25 && (query.walk || query.file_scores.size() != query.files.size())) {
+		error = "--rank bm25 needs the scores of an index, search with: pdfms query";
+		return nullptr;
+	}
+	if (!st.build_matcher(error))
+		return nullptr;
+	if (query.top)
+		sf.top = std::make_unique<TopK>(query.top, query.rank);
+
+	// --- Files in the requested order ---
+	const bool full_walk = query.shuffle || query.largest_first || query.path_order;
+	if (!query.walk) {
+		sf.pdfFileNames = std::move(query.files);
+		sf.candidatePages = std::move(query.candidate_pages);
+		if (sf.top && query.rank == Rank::bm25) {
+			// Best first: once the top is full, the files after its threshold are skipped unread
+			sf.fileScores = std::move(query.file_scores);
+			std::vector<size_t> order(sf.pdfFileNames.size());
+			for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+			std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sf.fileScores[a] > sf.fileScores[b]; });
+			pdf::apply_order(sf.pdfFileNames, order);
+			pdf::apply_order(sf.fileScores, order);
+			if (!sf.candidatePages.empty())
+				pdf::apply_order(sf.candidatePages, order);
+		} else if (query.path_order) {
+			std::vector<size_t> order(sf.pdfFileNames.size());
+			for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+			std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sf.pdfFileNames[a] < sf.pdfFileNames[b]; });
+			pdf::apply_order(sf.pdfFileNames, order);
+			if (!sf.candidatePages.empty())
+				pdf::apply_order(sf.candidatePages, order);
+		}
+	} else if (full_walk) {
+		auto walk_start = StatsClock::now();
+		sf.pdfFileNames = pdf::get_pdf_files(query.directory, query.shuffle && !query.path_order, opts.walk_threads);
+		search->walk_time = seconds_since(walk_start);
+	}
+	if (query.largest_first && !query.path_order) {
+		auto order = pdf::largest_first_order(sf.pdfFileNames);
+		pdf::apply_order(sf.pdfFileNames, order);
+		if (!sf.candidatePages.empty())
+			pdf::apply_order(sf.candidatePages, order);
+	}
+	sf.total_files = sf.pdfFileNames.size();
+
+	// --- Streaming walk, searching starts with the first directory listed ---
+	if (query.walk && !full_walk) {
+		sf.walk_done = false;
+		Search* s = search.get();
+		st.launch([s, directory = query.directory, walkers = opts.walk_threads]() {
+			auto walk_start = StatsClock::now();
+			DirectoryCrawler::crawl(directory, walkers, [&](std::vector<fs::path>& files) { s->files.addFiles(files); }, &s->files.aborted);
+			s->walk_time = seconds_since(walk_start);
+			s->files.finishWalk();
+		});
+	}
+
+	st.search();
+	return search;
+}
+
+bool SearchEngine::search(const Query& query, const std::function<void(const SearchResult&)>& on_result, std::string& error) {
+	auto s = start(query, error); // a copy, start() takes the query apart
+	if (!s)
+		return false;
+	std::shared_ptr<SearchResult> res;
+	while (s->next(res))
+		on_result(*res);
+	return true;
+}
+
+SearchEngine::Search::~Search() {
+	cancel();
+	wait();
+}
+
+bool SearchEngine::Search::finished() const {
+	return files.aborted || (files.walk_done && files.completed_files >= files.total_files);
+}
+
+void SearchEngine::Search::cancel() {
+	files.aborted = true;
+	files.queue_cv.notify_all();
+	threads.abort();
+}
+
+void SearchEngine::Search::wait(bool leave_hung) {
+	if (joined)
+		return;
+	joined = threads.join(leave_hung);
+}
+
+bool SearchEngine::Search::next(std::shared_ptr<SearchResult>& result) {
+	if (ranked_taken)
+		return next_ranked(result);
+	while (true) {
+		bool done = finished(); // before looking, so nothing that completes meanwhile is missed
+		if (done)
+			wait(true); // after an abort the open files still complete, dropped
+		for (size_t n = files.results.size(); returned < n; ++returned)
+			waiting.push_back(returned);
+		for (size_t k = 0; k < waiting.size(); ++k) {
+			std::shared_ptr<SearchResult>& res = files.results[waiting[k]];
+			if (!res->getCompleted())
+				continue;
+			waiting.erase(waiting.begin() + k--);
+			std::shared_ptr<SearchResult> completed = std::move(res); // released here, the caller keeps its copy
+			if (completed->getDropped() || completed->occurrenceCount() == 0 || files.top)
+				continue; // the files a top keeps come at the end
+			result = std::move(completed);
+			return true;
+		}
+		if (done)
+			return files.top && next_ranked(result);
+
+		std::unique_lock<std::mutex> lock(wait_mutex);
+		files.queue_cv.wait_for(lock, std::chrono::milliseconds(100), [&]() {
+			return files.aborted || files.updates.load(std::memory_order_acquire) != seen_updates;
+		});
+		seen_updates = files.updates.load(std::memory_order_acquire);
+	}
+}
+
+bool SearchEngine::Search::next_ranked(std::shared_ptr<SearchResult>& result) {
+	if (!ranked_taken) {
+		ranked = files.top->take();
+		ranked_taken = true;
+	}
+	if (next_rank == ranked.size())
+		return false;
+	result = std::move(ranked[next_rank++].result);
+	return true;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "SearchThreads.hpp"
+
+// Embeddable search: one long-lived engine serves any number of concurrent searches in-process.
+// The engine owns the thread pool the pipeline stages of all searches run on and the text cache they share.
+// A search is started with a Query and hands out its results as they complete, through next() or a callback.
+// Searches must be destroyed before their engine.
+class SearchEngine {
+public:
+	// Pipeline settings of every search, 0 = automatic
+	struct Options {
+		size_t threads = 0;             // extract threads per search
+		size_t readers = 2;
+		size_t matchers = 1;            // 0 matches on the extract threads
+		size_t read_queue_depth = 0;    // prefetched files waiting for extraction
+		size_t match_queue_depth = 256; // extracted pages waiting for matching
+		size_t walk_threads = 4;
+		bool use_mmap = false;
+		bool pin = false;               // bind the threads of a search to NUMA nodes and CPUs
+		bool use_cache = false;         // keep extracted text in the cache and search it instead of the PDF
+		fs::path cache_dir;             // pdf::default_cache_dir() if empty
+		bool memory_cache = false;      // keep extracted text in memory as well, for long-running servers
+		double file_timeout = 0;        // seconds per document, 0 = unlimited
+		int max_pages = 0;              // pages searched per document, 0 = all
+	};
+
+	struct Query {
+		std::vector<std::string> patterns;
+		bool regex = false;
+		bool normalize = false;
+		bool join_lines = false;                       // phrases match across line breaks and hyphenated line ends
+		fs::path directory;                            // walked for PDFs unless walk is false
+		bool walk = true;                              // false: search files instead
+		std::vector<fs::path> files;
+		std::vector<std::vector<int>> candidate_pages; // per file, zero based pages to scan, empty = all pages
+		std::vector<double> file_scores;               // per file, the index's BM25 score for Rank::bm25
+		int max_count = 0;                             // stop a file after this many occurrences
+		size_t limit = 0;                              // stop the search after this many files with matches
+		size_t top = 0;                                // only the best this many files by rank, 0 = all
+		Rank rank = Rank::hits;
+		size_t max_line = 0;                           // bytes of a line kept around its match, 0 = the whole line
+		int before_context = 0;                        // lines kept in front of a hit, within its page
+		int after_context = 0;                         // lines kept behind a hit
+		poppler::rectf region;                         // text of this part of every page only, bypasses the text cache
+		bool shuffle = false;
+		bool largest_first = false;
+		bool path_order = false;                       // files are searched in path order, which needs a full walk
+	};
+
+	// One running search. Its results are exposed in files.results like those of the CLI, next() hands them out
+	// in the order they complete and releases them. With a top the search runs to the end first, then next()
+	// hands out the best files in rank order.
+	class Search {
+		friend class SearchEngine;
+		size_t returned = 0; // results looked at by next() so far
+		std::vector<size_t> waiting; // results not completed as of the last look
+		std::vector<TopK::Entry> ranked; // with a top, taken once the search is over
+		bool ranked_taken = false;
+		size_t next_rank = 0;
+
+		bool next_ranked(std::shared_ptr<SearchResult>& result);
+		uint64_t seen_updates = ~uint64_t(0);
+		std::mutex wait_mutex;
+		bool joined = false;
+
+	public:
+		SearchedFiles files;
+		SearchThreads threads{ &files };
+		double walk_time = 0; // seconds, for --stats
+
+		Search() = default;
+		Search(const Search&) = delete;
+		Search& operator=(const Search&) = delete;
+		~Search();
+
+		// Waits for the next completed result with occurrences that isn't dropped. Returns false once there are none.
+		bool next(std::shared_ptr<SearchResult>& result);
+
+		// True once every file was searched, or the search was cancelled
+		bool finished() const;
+
+		// Stops the search, files that were being searched are dropped
+		void cancel();
+
+		// Waits until all threads of the search are done, called after finished() or cancel(). With leave_hung it
+		// doesn't wait for threads stuck in a document that timed out, the destructor still does.
+		void wait(bool leave_hung = false);
+	};
+
+	explicit SearchEngine(const Options& options);
+
+	const Options& options() const { return opts; }
+
+	// Null if neither cache is enabled
+	const std::shared_ptr<TextCache>& textCache() const { return cache; }
+
+	// Starts a search, or returns null with a message if a pattern is invalid
+	std::unique_ptr<Search> start(Query query, std::string& error);
+
+	// Runs a search to the end and calls on_result for every result that next() would return, on the calling thread
+	bool search(const Query& query, const std::function<void(const SearchResult&)>& on_result, std::string& error);
+
+private:
+	Options opts;
+	std::shared_ptr<TextCache> cache;
+	ThreadPool pool; // destroyed first, after the last search finished
+};
@@ -5,31 +5,139 @@
 namespace fs = std::filesystem;
 
 #include <vector>
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <string_view>
+#include <cstring>
 
+#include "AppendList.hpp"
+
+// 24 bytes: common terms produce millions of these, so the line is a pointer and a 32 bit length
 struct Occurence {
 	int page;
 	int line_number;
-	std::string line;
+	const char* line_data; // points into the LinePool of its SearchResult
+	uint32_t line_size;
+	int pattern = 0; // index into SearchedFiles::searchWords
+
+	std::string_view line() const { return std::string_view(line_data, line_size); }
+};
+
+// Bytes of the context lines (-B / -A) stored right in front of and behind the line of an occurrence
+struct LineContext {
+	uint32_t before = 0;
+	uint32_t after = 0;
+};
+
+// Append-only storage for the lines of one result, strings never move once added.
+// Blocks start small and double, so results with a single hit stay cheap.
+class LinePool {
+	static constexpr size_t first_block = 256;
+	static constexpr size_t max_block = size_t(64) << 10;
+	std::vector<std::unique_ptr<char[]>> blocks;
+	size_t block_size = 0;
+	size_t used = 0; // in the last block
+
+public:
+	std::string_view add(std::string_view s) { return add({}, s, {}); }
+
+	// Adds the three in a row, returns where middle is
+	std::string_view add(std::string_view front, std::string_view middle, std::string_view back) {
+		size_t size = front.size() + middle.size() + back.size();
+		if (size > block_size - used) {
+			block_size = std::max(std::min(block_size ? block_size * 2 : first_block, max_block), size);
+			blocks.emplace_back(new char[block_size]);
+			used = 0;
+		}
+		char* p = blocks.back().get() + used;
+		std::memcpy(p, front.data(), front.size());
+		std::memcpy(p + front.size(), middle.data(), middle.size());
+		std::memcpy(p + front.size() + middle.size(), back.data(), back.size());
+		used += size;
+		return std::string_view(p + front.size(), middle.size());
+	}
 };
 
+// Occurrences of one file, filled by the search threads and read by the printer without locking.
+// Occurrences are appended in the order they are found, which differs from page order when ranges or matchers
+// finish out of order; complete() publishes the page order together with the completed flag.
 class SearchResult {
-	fs::path pdf_path;
-	std::vector<Occurence> occurences;
-	bool completed = false;
-	bool printed = false; // True when the final 2-line output for this result has been printed and finalized.
-	int printingHeight = 0;
-	std::mutex mtx;
+	const fs::path pdf_path;
+	const size_t file_index; // into SearchedFiles::pdfFileNames
+	AppendList<Occurence> occurences;
+	AppendList<LineContext> contexts; // one per occurrence if with_context
+	const bool with_context;
+	LinePool lines;
+	std::mutex write_mtx; // serializes writers of lines, readers don't need it
+	std::vector<uint32_t> order; // indices sorted by page and line, written once by complete()
+	std::atomic<bool> completed{ false };
+	bool closed = false; // by complete(), under write_mtx; late occurrences of a file given up on are ignored
+	bool dropped = false; // not to be shown, written before completed
 public:
+	SearchResult(const fs::path& path, size_t file_index, bool with_context = false)
+		: pdf_path(path), file_index(file_index), with_context(with_context) {}
+
 	const fs::path& getPdfPath() const { return pdf_path; }
-	std::vector<Occurence> getOccurences() { std::lock_guard<std::mutex> guard(mtx); return occurences; }
-	bool getCompleted() { std::lock_guard<std::mutex> guard(mtx); return completed; }
-	bool getPrinted() { std::lock_guard<std::mutex> guard(mtx); return printed; }
-	int getPrintingHeight() { std::lock_guard<std::mutex> guard(mtx); return printingHeight; }
-	
-	void setPdfPath(const fs::path& path) { std::lock_guard<std::mutex> guard(mtx); pdf_path = path; }
-	void addOccurrence(const Occurence& occ) { std::lock_guard<std::mutex> guard(mtx); occurences.push_back(occ); }
-	void setCompleted(bool status = true) { std::lock_guard<std::mutex> guard(mtx); completed = status; }
-	void setPrinted(bool status = true) { std::lock_guard<std::mutex> guard(mtx); printed = status; }
-	void setPrintingHeight(int height) { std::lock_guard<std::mutex> guard(mtx); printingHeight = height; }
-};
\ No newline at end of file
+	size_t getFileIndex() const { return file_index; }
+
+	// Occurrences found so far in the order they were found, i < occurrenceCount()
+	size_t occurrenceCount() const { return occurences.size(); }
+	const Occurence& occurrence(size_t i) const { return occurences[i]; }
+
+	// Ordered by page and line, only valid once getCompleted() returned true
+	const Occurence& sortedOccurrence(size_t i) const { return occurences[order[i]]; }
+
+	// Context lines around sortedOccurrence(i): before ends with a line break, after starts with one.
+	// Empty without context or where the page begins or ends.
+	bool hasContext() const { return with_context; }
+	std::string_view sortedBefore(size_t i) const {
+		if (!with_context) return {};
+		const Occurence& occ = occurences[order[i]];
+		return std::string_view(occ.line_data - contexts[order[i]].before, contexts[order[i]].before);
+	}
+	std::string_view sortedAfter(size_t i) const {
+		if (!with_context) return {};
+		const Occurence& occ = occurences[order[i]];
+		return std::string_view(occ.line_data + occ.line_size, contexts[order[i]].after);
+	}
+
+	bool getCompleted() const { return completed.load(std::memory_order_acquire); }
+	// Cut short by an abort, beyond --limit or not among the --top, only valid once getCompleted() returned true
+	bool getDropped() const { return dropped; }
+
+	// Copies the line and its context lines into the pool, the page text they come from may be reused afterwards
+	void addOccurrence(int page, int line_number, std::string_view line, int pattern, std::string_view before = {}, std::string_view after = {}) {
+		std::lock_guard<std::mutex> guard(write_mtx);
+		if (closed) return;
+		// Several patterns on one line share its copy
+		size_t n = occurences.size();
+		std::string_view copy;
+		if (n && occurences[n - 1].page == page && occurences[n - 1].line_number == line_number && occurences[n - 1].line() == line) {
+			copy = occurences[n - 1].line();
+			if (with_context) contexts.push_back(contexts[n - 1]);
+		} else if (with_context) {
+			copy = lines.add(before, line, after);
+			contexts.push_back(LineContext{ uint32_t(before.size()), uint32_t(after.size()) });
+		} else {
+			copy = lines.add(line);
+		}
+		occurences.push_back(Occurence{ page, line_number, copy.data(), uint32_t(copy.size()), pattern });
+	}
+
+	// Called once when all pages were searched or the file was given up on, later occurrences are ignored
+	void complete(bool drop = false) {
+		std::lock_guard<std::mutex> guard(write_mtx);
+		closed = true;
+		dropped = drop;
+		size_t n = occurences.size();
+		order.resize(n);
+		for (size_t i = 0; i < n; ++i) order[i] = uint32_t(i);
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			const Occurence& x = occurences[a];
+			const Occurence& y = occurences[b];
+			return x.page < y.page || (x.page == y.page && x.line_number < y.line_number);
+		});
+		completed.store(true, std::memory_order_release);
+	}
+};
@@ -0,0 +1,376 @@
+#pragma once
+
+#include "SearchEngine.hpp"
+#include "OutThread.hpp"
+#include "FileWatcher.hpp"
+
+#include <set>
+
+// A search as a client sends it to the server, with how its results are to be written.
+// On the wire one "key value" line per field and pattern, closed by "end". Patterns never contain a line break,
+// the search is line based.
+struct ServeRequest {
+	std::vector<std::string> patterns;
+	fs::path directory; // absolute, only files below it are searched
+	bool regex = false;
+	bool normalize = false;
+	bool join_lines = false;
+	int max_count = 0;
+	size_t limit = 0;
+	size_t top = 0;
+	Rank rank = Rank::hits;
+	size_t max_line = 0;
+	int before_context = 0;
+	int after_context = 0;
+	std::string region; // as given to --region, empty = whole pages
+	std::string token; // --token of the server
+	OutThread::Format format = OutThread::Format::text; // a streaming format, the client can't redraw
+	OutThread::Sort sort = OutThread::Sort::none;
+	bool files_only = false;
+	bool print_line = false;
+	bool print_path = false;
+
+	// The token goes first, the server turns away a wrong one before reading the rest
+	std::string encode() const {
+		std::string s = "token " + token + "\n"
+			+ "directory " + directory.u8string() + "\n"
+			+ "regex " + std::to_string(int(regex)) + "\n"
+			+ "normalize " + std::to_string(int(normalize)) + "\n"
+			+ "join_lines " + std::to_string(int(join_lines)) + "\n"
+			+ "max_count " + std::to_string(max_count) + "\n"
+			+ "limit " + std::to_string(limit) + "\n"
+			+ "top " + std::to_string(top) + "\n"
+			+ "rank " + std::to_string(int(rank)) + "\n"
+			+ "max_line " + std::to_string(max_line) + "\n"
+			+ "before_context " + std::to_string(before_context) + "\n"
+			+ "after_context " + std::to_string(after_context) + "\n"
+			+ "format " + std::to_string(int(format)) + "\n"
+			+ "sort " + std::to_string(int(sort)) + "\n"
+			+ "files_only " + std::to_string(int(files_only)) + "\n"
+			+ "print_line " + std::to_string(int(print_line)) + "\n"
+			+ "print_path " + std::to_string(int(print_path)) + "\n"
+			+ "region " + region + "\n";
+		for (const auto& p : patterns)
+			s += "pattern " + p + "\n";
+		return s + "end\n";
+	}
+
+	// Applies one line, returns false for a line it doesn't know
+	bool decode(const std::string& line) {
+		size_t space = line.find(' ');
+		if (space == std::string::npos) return false;
+		std::string key = line.substr(0, space), value = line.substr(space + 1);
+		if (key == "pattern") patterns.push_back(value);
+		else if (key == "directory") directory = fs::u8path(value);
+		else if (key == "regex") regex = value == "1";
+		else if (key == "normalize") normalize = value == "1";
+		else if (key == "join_lines") join_lines = value == "1";
+		else if (key == "max_count") max_count = std::max(0, std::atoi(value.c_str()));
+		else if (key == "limit") limit = std::strtoul(value.c_str(), nullptr, 10);
+		else if (key == "top") top = std::strtoul(value.c_str(), nullptr, 10);
+		else if (key == "rank") rank = Rank(std::clamp(std::atoi(value.c_str()), 0, 2));
+		else if (key == "max_line") max_line = std::strtoul(value.c_str(), nullptr, 10);
+		else if (key == "before_context") before_context = std::max(0, std::atoi(value.c_str()));
+		else if (key == "after_context") after_context = std::max(0, std::atoi(value.c_str()));
+		else if (key == "format") format = OutThread::Format(std::clamp(std::atoi(value.c_str()), 1, 3));
+		else if (key == "sort") sort = OutThread::Sort(std::clamp(std::atoi(value.c_str()), 0, 2));
+		else if (key == "files_only") files_only = value == "1";
+		else if (key == "print_line") print_line = value == "1";
+		else if (key == "print_path") print_path = value == "1";
+		else if (key == "region") region = value;
+		else if (key == "token") token = value;
+		else return false;
+		return true;
+	}
+};
+
+// pdfms --serve: keeps the file list of a directory and the extracted text of its PDFs in memory and answers
+// searches of thin clients over a Unix domain socket, or with --listen over TCP as a worker of a --workers
+// coordinator. A FileWatcher keeps the list current, so no search walks the tree again. Text is extracted by
+// the first search that needs it and again only once the file changed (the cache entries are keyed by size and
+// modification time), removed files are dropped from memory.
+// Every client gets a thread of its own, up to max_clients at once, its search runs on the engine's pool like
+// any other. Requests are limited in size and in the time a client may take to send them.
+// The response is "ok" and the output in the requested format, or "error <message>". TCP is unencrypted,
+// --token keeps other hosts on the network from searching and is required unless only loopback is bound.
+class SearchServer {
+	SearchEngine& engine;
+	fs::path root;
+	fs::path socket_path;
+
+	static constexpr size_t max_line = 64 << 10;     // bytes of one request line
+	static constexpr size_t max_request = 1 << 20;   // bytes of a whole request, some thousand patterns
+	static constexpr int request_timeout = 10;       // seconds a client may pause while sending its request
+	static constexpr size_t max_clients = 64;        // connections served at once, more are turned away
+	std::atomic<size_t> clients{0};
+
+	std::mutex files_mtx;
+	std::set<fs::path> files;
+	std::shared_ptr<const std::vector<fs::path>> snapshot; // of files in path order, rebuilt after a change
+	FileWatcher watcher;
+
+	// True if path is dir or below it
+	static bool is_within(const fs::path& path, const fs::path& dir) {
+		auto d = dir.begin(), p = path.begin();
+		for (; d != dir.end() && !d->empty(); ++d, ++p)
+			if (p == path.end() || *d != *p) return false;
+		return true;
+	}
+
+	void forget(const fs::path& path) {
+		if (engine.textCache()) engine.textCache()->forget(path);
+	}
+
+	void on_change(const fs::path& path, FileWatcher::Change change) {
+		if (change == FileWatcher::Change::rescan) {
+			auto found = pdf::get_pdf_files(root, false, engine.options().walk_threads);
+			std::set<fs::path> current(found.begin(), found.end());
+			std::lock_guard<std::mutex> lock(files_mtx);
+			for (const auto& f : files)
+				if (!current.count(f)) forget(f);
+			files.swap(current);
+			snapshot.reset();
+			return;
+		}
+		std::lock_guard<std::mutex> lock(files_mtx);
+		if (change == FileWatcher::Change::updated) {
+			files.insert(path);
+		} else {
+			for (auto it = files.lower_bound(path); it != files.end() && is_within(*it, path);) {
+				forget(*it);
+				it = files.erase(it);
+			}
+		}
+		snapshot.reset();
+	}
+
+	std::shared_ptr<const std::vector<fs::path>> current_files() {
+		std::lock_guard<std::mutex> lock(files_mtx);
+		if (!snapshot)
+			snapshot = std::make_shared<const std::vector<fs::path>>(files.begin(), files.end());
+		return snapshot;
+	}
+
+#ifndef _WIN32
+	// Compared in constant time, the time of a rejection tells nothing about the token
+	bool authorized(const std::string& given) const {
+		unsigned char diff = given.size() != token.size();
+		for (size_t i = 0; i < token.size(); ++i)
+			diff |= (unsigned char)(token[i] ^ (i < given.size() ? given[i] : 0));
+		return diff == 0;
+	}
+
+	// Reads the request of a client, false once an error response was sent. Nothing that doesn't carry the
+	// token as its first line is read any further, and neither is a request beyond the size limits.
+	bool read_request(int fd, ServeRequest& req) {
+		net::set_receive_timeout(fd, request_timeout);
+		std::string buffer, line;
+		size_t size = 0;
+		bool complete = false, first = true;
+		while (net::read_line(fd, buffer, line, max_line)) {
+			size += line.size() + 1;
+			if (size > max_request) break;
+			if (line == "end") { complete = true; break; }
+			req.decode(line); // unknown fields of newer clients are ignored
+			if (first && !authorized(req.token)) {
+				net::write_all(fd, "error wrong or missing --token\n");
+				return false;
+			}
+			first = false;
+		}
+		if (!complete && (size > max_request || buffer.size() >= max_line)) {
+			net::write_all(fd, "error request too large\n");
+			return false;
+		}
+		if (!complete || req.patterns.empty()) {
+			net::write_all(fd, "error incomplete request\n");
+			return false;
+		}
+		return true;
+	}
+
+	void serve_client(int fd) {
+		ServeRequest req;
+		if (!read_request(fd, req)) {
+			net::close(fd);
+			return;
+		}
+
+		SearchEngine::Query query;
+		query.patterns = req.patterns;
+		query.regex = req.regex;
+		query.normalize = req.normalize;
+		query.join_lines = req.join_lines;
+		query.max_count = req.max_count;
+		query.limit = req.limit;
+		query.top = req.top;
+		query.rank = req.rank;
+		query.max_line = req.max_line;
+		query.before_context = req.before_context;
+		query.after_context = req.after_context;
+		if (!req.region.empty() && !pdf::parse_region(req.region, query.region)) {
+			net::write_all(fd, "error invalid region " + req.region + "\n");
+			net::close(fd);
+			return;
+		}
+		query.walk = false;
+		query.path_order = req.sort == OutThread::Sort::path;
+		auto all = current_files();
+		if (req.directory.empty() || is_within(root, req.directory)) {
+			query.files = *all;
+		} else {
+			for (auto it = std::lower_bound(all->begin(), all->end(), req.directory); it != all->end() && is_within(*it, req.directory); ++it)
+				query.files.push_back(*it);
+		}
+
+		std::string error;
+		auto search = engine.start(std::move(query), error);
+		if (!search) {
+			net::write_all(fd, "error " + error + "\n");
+			net::close(fd);
+			return;
+		}
+		FILE* out = net::write_all(fd, "ok\n") ? fdopen(fd, "w") : nullptr;
+		if (!out) {
+			search->cancel();
+			net::close(fd);
+			return;
+		}
+		OutThread ot(&search->files);
+		ot.format = req.format;
+		ot.sort = req.sort;
+		ot.files_only = req.files_only;
+		ot.print_line = req.print_line;
+		ot.print_path = req.print_path;
+		ot.output = out;
+		ot.print();
+		search->cancel();
+		search->wait(true); // the response doesn't wait for a document that timed out
+		ot.finish();
+		std::fclose(out);
+	}
+#endif
+
+public:
+	std::string listen_address; // --listen host:port: TCP instead of the Unix socket, a worker for --workers
+	std::string token;          // --token: secret every request has to carry, empty = none (loopback only)
+
+	SearchServer(SearchEngine& engine, const fs::path& root, const fs::path& socket_path)
+		: engine(engine), root(absolute_dir(root)), socket_path(socket_path),
+		  watcher(this->root, [this](const fs::path& p, FileWatcher::Change c) { on_change(p, c); }) {}
+
+	// Absolute and without a trailing separator, as the walk and the watcher report paths below it
+	static fs::path absolute_dir(const fs::path& dir) {
+		fs::path p = fs::absolute(dir).lexically_normal();
+		return p.has_filename() || p == p.root_path() ? p : p.parent_path();
+	}
+
+	// Default socket of the user, next to the text cache
+	static fs::path default_socket() { return pdf::default_cache_dir() / "pdfms.sock"; }
+
+	// Serves until the process is terminated, returns 1 if the socket can't be set up
+	int run(std::ostream& info) {
+	#ifdef _WIN32
+		info << "--serve needs sockets, which this build doesn't support\n";
+		return 1;
+	#else
+		std::signal(SIGPIPE, SIG_IGN); // a client that goes away is a failed write, its search stops
+
+		std::string error;
+		int listen_fd;
+		if (!listen_address.empty()) {
+			// Without a token any host that reaches the port could search, only this machine may go without one
+			if (token.empty() && !net::is_loopback(listen_address)) {
+				info << "--listen " << listen_address << " is reachable from other hosts, set --token or PDFMS_TOKEN"
+					 << " (or listen on 127.0.0.1:<port>)\n";
+				return 1;
+			}
+			listen_fd = net::listen_tcp(listen_address, error);
+		} else {
+			int probe = net::connect_unix(socket_path);
+			if (probe >= 0) {
+				net::close(probe);
+				info << "Another server is listening on " << socket_path << "\n";
+				return 1;
+			}
+			std::error_code ec;
+			fs::create_directories(socket_path.parent_path(), ec);
+			::unlink(socket_path.c_str()); // left behind by a server that was killed
+			listen_fd = net::listen_unix(socket_path, error);
+		}
+		if (listen_fd < 0) {
+			info << error << "\n";
+			return 1;
+		}
+
+		// Watching starts before the walk, nothing that changes in between is missed
+		watcher.start();
+		auto found = pdf::get_pdf_files(root, false, engine.options().walk_threads);
+		{
+			std::lock_guard<std::mutex> lock(files_mtx);
+			files.insert(found.begin(), found.end());
+			snapshot.reset();
+		}
+		info << "serving " << found.size() << " files below " << root.string() << " on "
+			 << (listen_address.empty() ? socket_path.string() : listen_address) << "\n";
+
+		while (true) {
+			int fd = net::accept(listen_fd);
+			if (fd < 0) {
+				info << "accept failed: " << std::strerror(errno) << "\n";
+				break;
+			}
+			if (clients >= max_clients) {
+				net::write_all(fd, "error too many clients, try again later\n");
+				net::close(fd);
+				continue;
+			}
+			++clients;
+			std::thread([this, fd]() { serve_client(fd); --clients; }).detach();
+		}
+		watcher.stop();
+		net::close(listen_fd);
+		if (listen_address.empty())
+			::unlink(socket_path.c_str());
+		return 1;
+	#endif
+	}
+
+	// Sends the request on a connected socket and reads the status line. Returns false with the message of an
+	// error response, buffer keeps what was read beyond the status.
+	static bool send_request(int fd, const ServeRequest& req, std::string& buffer, std::string& error) {
+		std::string status;
+		if (net::write_all(fd, req.encode()) && net::read_line(fd, buffer, status) && status == "ok")
+			return true;
+		error = status.rfind("error ", 0) == 0 ? status.substr(6) : "the server closed the connection";
+		return false;
+	}
+
+	// pdfms --client: sends the request and copies the response to stdout, returns the exit code
+	static int run_client(const fs::path& socket_path, const ServeRequest& req) {
+	#ifdef _WIN32
+		std::cerr << "--client needs sockets, which this build doesn't support\n";
+		return 1;
+	#else
+		int fd = net::connect_unix(socket_path);
+		if (fd < 0) {
+			std::cerr << "No server on " << socket_path << ", start one with: pdfms --serve <directory>\n";
+			return 1;
+		}
+		std::string buffer, error;
+		if (!send_request(fd, req, buffer, error)) {
+			std::cerr << error << "\n";
+			net::close(fd);
+			return 1;
+		}
+		std::fwrite(buffer.data(), 1, buffer.size(), stdout);
+		char chunk[1 << 16];
+		ssize_t n;
+		while ((n = ::read(fd, chunk, sizeof(chunk))) > 0 || (n < 0 && errno == EINTR))
+			if (n > 0) std::fwrite(chunk, 1, size_t(n), stdout);
+		std::fflush(stdout);
+		net::close(fd);
+		return 0;
+	#endif
+	}
+};
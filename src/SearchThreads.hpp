@@ -2,94 +2,904 @@
 
 #include "SearchedFiles.hpp"
 #include "util.hpp"
+#include "AhoCorasick.hpp"
+#include "RegexMatcher.hpp"
+#include "TextFolder.hpp"
+#include "WorkDeque.hpp"
+#include "BoundedQueue.hpp"
+#include "FileData.hpp"
+#include "Stats.hpp"
+#include "ThreadPool.hpp"
 
+// One file being searched, shared by the pipeline stages and all page ranges of it
+struct FileJob {
+	fs::path pdf_path;
+	size_t file_index = 0; // into SearchedFiles::pdfFileNames
+	std::string pdf_path_str;
+	std::shared_ptr<SearchResult> result;
+	const std::vector<int>* only_pages = nullptr; // set by index queries, otherwise all pages
+	int page_count = 0; // pages of the document
+	std::atomic<int> remaining_pages{ 0 }; // positions neither matched nor skipped yet
+	std::atomic<bool> incomplete{ false }; // a range was aborted or failed to load
+	std::atomic<int64_t> busy_ns{ 0 }; // load, extraction and matching time of all threads, for --stats
+	std::atomic<int> hits{ 0 }; // occurrences so far, counted for --max-count
+	std::atomic<bool> skipped_pages{ false }; // pages left out after --max-count was reached, the text is incomplete
+	std::atomic<bool> completed{ false }; // the result was completed, by the last page or by the watchdog
+	std::atomic<bool> timed_out{ false }; // --file-timeout ran out, recorded in SearchedFiles::fileErrors
+	std::atomic<int64_t> deadline_ns{ 0 }; // StatsClock time the file has to be done by, 0 = none
+	int max_pages = 0; // --max-pages, 0 = all
+	pdf::TextHint text_hint = pdf::TextHint::unknown; // from the raw bytes, set by the reader stage
+
+	FileData data; // whole file, prefetched by the reader stage
+
+	bool cacheable = false;
+	bool cache_hit = false;
+	FileKey key;
+	std::vector<std::string> cached_pages; // text of a cache hit, loaded by the reader stage
+	std::vector<std::string> extracted_pages; // only filled when the text gets cached, one slot per page
+
+	int listed() const { return only_pages ? (int)only_pages->size() : page_count; }
+	int positions() const { return max_pages ? std::min(max_pages, listed()) : listed(); }
+	int page_at(int position) const { return only_pages ? (*only_pages)[position] : position; }
+};
+
+// Positions [begin, end) of a job's page list
+struct PageRange {
+	std::shared_ptr<FileJob> job;
+	int begin = 0;
+	int end = 0;
+};
+
+// Extracted text of one page on its way to the matcher stage
+struct PageText {
+	std::shared_ptr<FileJob> job;
+	int page = 0;
+	std::string text;
+};
+
+// Three stage pipeline connected by bounded queues:
+//   readers   prefetch whole files (or their cached text) into memory
+//   extract   Poppler parsing and text extraction, large documents are split into page ranges for work stealing
+//   matchers  run the PageMatcher over extracted pages
 struct SearchThreads {
-	std::vector<std::thread> pool;
+	std::vector<std::thread> pool; // own threads, without a thread pool
+	ThreadPool* thread_pool = nullptr; // runs the stages when set, e.g. by a SearchEngine
 	SearchedFiles* sf;
-	std::string targetLower;
+	std::unique_ptr<PageMatcher> matcher;
+	TextFolder folder;
+	bool fold_pages = false; // non-ASCII pages are folded before matching
+
+	// --- Pipeline settings, 0 = automatic ---
+	size_t num_threads = 0;          // extract threads (-j)
+	size_t num_readers = 2;
+	size_t num_matchers = 1;         // 0 matches on the extract threads
+	size_t read_queue_depth = 0;     // prefetched files waiting for extraction
+	size_t match_queue_depth = 256;  // extracted pages waiting for matching
+	bool use_mmap = false;           // map files instead of reading them into pooled buffers
+	int max_count = 0;               // -m: stop a file after this many occurrences, -l is 1
+	size_t limit = 0;                // --limit: stop the search after this many files with matches
+	bool regex = false;              // -e / --regex: the search words are regular expressions
+	bool normalize = false;          // --normalize: NFKC and full case folding on top of the simple folding
+	double file_timeout = 0;         // --file-timeout: seconds per document, 0 = unlimited
+	int max_pages = 0;               // --max-pages: pages searched per document, 0 = all
+	size_t max_line = 0;             // --max-line: bytes of a line kept around its match, 0 = the whole line
+	int before_context = 0;          // -B: lines before a hit kept with it, within its page
+	int after_context = 0;           // -A: lines after a hit
+	bool join_lines = false;         // --join-lines: phrases match across line breaks and hyphenation
+	poppler::rectf region;           // --region: text of this part of every page only, empty = the whole page
+	bool pin = false;                // --pin: threads are bound to a NUMA node, extract threads to one CPU of it
+
+	// Documents with at least this many pages are split into ranges other threads can steal
+	static constexpr int split_min_pages = 64;
+	static constexpr int min_range_pages = 16;
+
+	// Before the queues, jobs and pages left in them at the end return their buffers here
+	BufferPool<> buffers;
+	BufferPool<std::string> text_buffers; // page text on its way from extraction to matching
+	std::vector<std::unique_ptr<BoundedQueue<std::shared_ptr<FileJob>>>> loaded; // one per NUMA node with --pin
+	std::unique_ptr<BoundedQueue<PageText>> extracted;
+	std::unique_ptr<WorkDeque<PageRange>[]> queues;
+	alignas(64) std::atomic<int> pending{ 0 }; // queued ranges plus files being opened (which may still queue ranges)
+	alignas(64) std::atomic<size_t> active_readers{ 0 };
+	std::atomic<size_t> active_extractors{ 0 };
+	std::vector<ThreadStats> thread_stats; // one per thread in pool order, collected after the join
+	std::mutex stats_mtx; // extract threads add their stats when they end, a hung one may do so late
+
+	// What each extract thread works on, for the watchdog
+	struct ExtractSlot {
+		std::mutex mtx;
+		std::shared_ptr<FileJob> job;
+		unsigned generation = 0; // bumped when the watchdog replaces the thread
+	};
+	std::unique_ptr<ExtractSlot[]> slots;
+	std::vector<std::vector<int>> nodes; // --pin: CPUs of each NUMA node, a single node without it
+	std::atomic<size_t> hung{ 0 }; // extract threads the watchdog replaced that didn't return yet
+
+	// Stages still running on the thread pool
+	std::mutex running_mtx;
+	std::condition_variable running_cv;
+	size_t running = 0;
+
 	SearchThreads(SearchedFiles* sf) : sf(sf) {
 		
 	}
 
-	void search() {
-		targetLower = pdf::tolower(sf->searchWord);
-
-		auto worker_func = [&]() {
-			while (!sf->aborted) {
-				size_t idx = sf->file_index.fetch_add(1);
-				if (idx >= sf->total_files) {
-					//std::cout << "No more files to process\n";
-					break; // No more files to process
-				}
+	// Runs fn on a thread of its own or on the thread pool, join() waits for it either way. With cpus the thread
+	// is bound to them while fn runs, a pool thread gets its previous CPUs back for the next task.
+	void launch(std::function<void()> fn, std::vector<int> cpus = {}) {
+		{
+			std::lock_guard<std::mutex> lock(running_mtx);
+			running++;
+		}
+		auto task = [this, fn = std::move(fn), cpus = std::move(cpus), pooled = thread_pool != nullptr]() {
+			std::vector<int> previous;
+			if (!cpus.empty()) {
+				if (pooled) previous = cpu::thread_cpus();
+				cpu::pin_thread(cpus);
+			}
+			fn();
+			if (!previous.empty())
+				cpu::pin_thread(previous);
+			std::lock_guard<std::mutex> lock(running_mtx); // notified under the lock, join() may destroy this right after
+			running--;
+			running_cv.notify_all(); // join(true) waits for the count to come down to the hung threads
+		};
+		if (thread_pool)
+			thread_pool->run(std::move(task));
+		else
+			pool.emplace_back(std::move(task));
+	}
 
-				const auto& pdf_path = sf->pdfFileNames[idx];
-				std::string pdf_path_str;
-				try {
-					pdf_path_str = pdf_path.string();
-				} catch (...) {
-					sf->completed_files++;
-					sf->erroredPaths.push_back(pdf_path.u8string());
-					continue;
-				}
+	// Waits for everything launched so far. With leave_hung it returns while threads the watchdog replaced are
+	// still stuck in Poppler and returns false, this must not be destroyed before a full join() then.
+	bool join(bool leave_hung = false) {
+		std::unique_lock<std::mutex> lock(running_mtx);
+		running_cv.wait(lock, [&]() { return running <= (leave_hung ? hung.load() : 0); });
+		if (running)
+			return false;
+		lock.unlock();
+		for (auto& t : pool) t.join();
+		pool.clear();
+		return true;
+	}
 
-				poppler::document* doc = nullptr;
-				try {
-					doc = poppler::document::load_from_file(pdf_path_str);
-				} catch (...) {
-					doc = nullptr;
-				}
+	// The stats of all threads, also of those still stuck after join(true)
+	std::vector<ThreadStats> stats() {
+		std::lock_guard<std::mutex> lock(stats_mtx);
+		return thread_stats;
+	}
+
+	// Every file gets a result, also those that fail early, so sorted output knows when a file is done
+	std::shared_ptr<SearchResult> add_result(const fs::path& pdf_path, size_t file_index) {
+		std::shared_ptr<SearchResult> current_res = std::make_shared<SearchResult>(pdf_path, file_index, before_context > 0 || after_context > 0);
+		sf->results.push_back(current_res);
+		return current_res;
+	}
+
+	// Narrows the line [begin, end) of text to max bytes centered on the match [pos, pos_end), without splitting
+	// a character. Lines of PDFs without line breaks can be whole pages, each hit would keep a copy of it.
+	static void clip_line(std::string_view text, size_t& begin, size_t& end, size_t pos, size_t pos_end, size_t max) {
+		if (end - begin <= max) return;
+		size_t lead = pos_end - pos < max ? (max - (pos_end - pos)) / 2 : 0;
+		size_t from = pos - begin > lead ? pos - lead : begin;
+		from = std::min(from, end - max);
+		size_t to = from + max;
+		while (from < to && (text[from] & 0xC0) == 0x80) from++;
+		while (to > from && to < end && (text[to] & 0xC0) == 0x80) to--;
+		begin = from;
+		end = to;
+	}
+
+	// Up to n lines in front of the line that starts at begin, each with its line break
+	static std::string_view lines_before(std::string_view text, size_t begin, int n) {
+		size_t from = begin;
+		for (; n > 0 && from > 0; --n) {
+			size_t nl = from >= 2 ? text.rfind('\n', from - 2) : std::string_view::npos;
+			from = nl == std::string_view::npos ? 0 : nl + 1;
+		}
+		return text.substr(from, begin - from);
+	}
+
+	// Up to n lines behind the line that ends at end, each after its line break. A break that ends the page starts no line.
+	static std::string_view lines_after(std::string_view text, size_t end, int n) {
+		size_t to = end;
+		for (; n > 0 && to + 1 < text.size(); --n) {
+			size_t nl = text.find('\n', to + 1);
+			to = nl == std::string_view::npos ? text.size() : nl;
+		}
+		return text.substr(end, to - end);
+	}
+
+	// Context lines cut to max bytes each like the hit line, composed in buffer if one was longer
+	static std::string_view clip_lines(std::string_view lines, size_t max, std::string& buffer) {
+		if (!max || lines.size() <= max) return lines;
+		buffer.clear();
+		for (size_t start = 0;;) {
+			size_t nl = std::min(lines.find('\n', start), lines.size());
+			size_t cut = std::min(nl - start, max);
+			while (cut > 0 && cut < nl - start && (lines[start + cut] & 0xC0) == 0x80) cut--;
+			buffer.append(lines.substr(start, cut));
+			if (nl == lines.size()) break;
+			buffer += '\n';
+			start = nl + 1;
+		}
+		return buffer;
+	}
+
+	// Runs the matcher over the whole page, line numbers and line text are only computed for hits.
+	// Every line yields at most one occurrence per pattern.
+	// Pages with non-ASCII text are folded first when that can matter for the patterns, ASCII pages are
+	// searched as they are.
+	void match_page(int i, std::string_view page_text, FileJob& job, ThreadStats& ts) {
+		SearchResult& current_res = *job.result;
+		const bool single = matcher->patternCount() == 1;
+		std::vector<size_t> recorded_line; // per pattern: start of the line it was last recorded for
+		if (!single) recorded_line.assign(matcher->patternCount(), std::string_view::npos);
+
+		// Folded page and where in page_text its bytes come from, reused by the thread
+		static thread_local std::string folded;
+		static thread_local OffsetMap offsets;
+		std::string_view text = page_text;
+		const bool mapped = fold_pages && (folder.joins() || !TextFolder::is_ascii(page_text));
+		if (mapped) {
+			folder.fold(page_text, folded, &offsets);
+			text = folded;
+		}
+		auto original = [&](size_t p) { return mapped ? offsets.original(p) : p; };
+
+		// Lines are found in page_text, joined text has no line breaks left
+		size_t counted = 0; // newlines before this offset are included in line_number
+		int line_number = 1;
+		size_t line_start = 0, line_end = 0; // line of the previous hit, in page_text, line_end at its break
+		bool have_line = false;
+		bool found = false;
+		matcher->scan(text, [&](size_t pos, size_t len, int pattern) -> size_t {
+			if (max_count && job.hits >= max_count)
+				return text.size(); // enough, skip the rest of the page
+			size_t at = original(pos);
+			// Several patterns report in order of their end, a longer joined hit can start on an earlier line
+			if (!have_line || at > line_end || at < line_start) {
+				if (at >= counted) line_number += (int)std::count(page_text.begin() + counted, page_text.begin() + at, '\n');
+				else line_number -= (int)std::count(page_text.begin() + at, page_text.begin() + counted, '\n');
+				counted = at;
+				line_start = at ? page_text.rfind('\n', at - 1) : std::string_view::npos;
+				line_start = line_start == std::string_view::npos ? 0 : line_start + 1;
+				line_end = page_text.find('\n', at);
+				if (line_end == std::string_view::npos) line_end = page_text.size();
+				have_line = true;
+			}
+			if (!single) {
+				if (recorded_line[pattern] == line_start) return pos;
+				recorded_line[pattern] = line_start;
+			}
+
+			// Add occurrence directly to shared SearchResult, with the line as it was extracted.
+			// A joined hit that continues on the next lines gets them too, with their breaks as spaces.
+			size_t begin = line_start;
+			size_t end = line_end;
+			size_t hit_end = original(pos + len);
+			if (hit_end > end + 1) {
+				end = page_text.find('\n', hit_end - 1);
+				if (end == std::string_view::npos) end = page_text.size();
+			}
+			// Context only around hits, from the page text that is at hand anyway
+			std::string_view before, after;
+			if (before_context || after_context) {
+				static thread_local std::string before_buffer, after_buffer;
+				before = clip_lines(lines_before(page_text, begin, before_context), max_line, before_buffer);
+				after = clip_lines(lines_after(page_text, line_end, after_context), max_line, after_buffer); // numbered from the hit's line
+			}
+			if (max_line)
+				clip_line(page_text, begin, end, at, hit_end, max_line);
+			std::string_view line = page_text.substr(begin, end - begin);
+			if (end > line_end) {
+				static thread_local std::string joined_line;
+				joined_line.assign(line.data(), line.size());
+				std::replace(joined_line.begin(), joined_line.end(), '\n', ' ');
+				line = joined_line;
+			}
+			current_res.addOccurrence(i + 1, line_number, line, pattern, before, after);
+			ts.occurrences++;
+			job.hits++;
+			found = true;
+
+			// A single pattern is done with this line, others may still follow on it
+			if (!single) return pos;
+			return mapped ? offsets.folded(line_end, pos) : line_end;
+		});
+		// Lets the printer pick up incremental page findings, batched across pages and threads
+		if (found)
+			sf->notifyProgress();
+	}
+
+	// --- Reader stage ---
+
+	// Completes a file that couldn't be read, with an empty result
+	void fail_read(FileJob& job) {
+		add_result(job.pdf_path, job.file_index)->complete();
+		sf->completed_files++;
+		sf->notifyUpdate();
+	}
+
+	// Prefetches the next files: cached text on a cache hit, otherwise the whole PDF.
+	// Running ahead by the read queue depth overlaps the I/O of the next files with the extraction of earlier ones.
+	void read_files(size_t reader, ThreadStats& ts) {
+		auto& queue = *loaded[reader % loaded.size()]; // the buffers are first touched on this node, extracted there
+		while (!sf->aborted) {
+			size_t idx = sf->file_index.fetch_add(1);
+			fs::path pdf_path;
+			auto wait_start = StatsClock::now();
+			bool got = sf->getFile(idx, pdf_path); // waits for a streaming walk
+			ts.idle_time += seconds_since(wait_start);
+			if (!got)
+				break; // No more files to process
+			auto job = std::make_shared<FileJob>();
+			job->pdf_path = pdf_path;
+			job->file_index = idx;
+			try {
+				job->pdf_path_str = pdf_path.string();
+			} catch (...) {
+				sf->erroredPaths.push_back(pdf_path.u8string());
+				ts.path_errors++;
+				fail_read(*job);
+				continue;
+			}
+			if (idx < sf->candidatePages.size() && !sf->candidatePages[idx].empty())
+				job->only_pages = &sf->candidatePages[idx];
+			if (sf->top && idx < sf->fileScores.size() && sf->fileScores[idx] < sf->top->threshold()) {
+				ts.pruned++; // the index score says it can't make the --top, whatever the file contains
+				fail_read(*job);
+				continue;
+			}
+
+			auto read_start = StatsClock::now();
+			job->cacheable = sf->textCache && region.is_empty() && FileKey::fromPath(pdf_path, job->key); // cached text is of whole pages
+			if (job->cacheable && sf->textCache->load(job->key, job->cached_pages)) {
+				job->cache_hit = true;
+				job->cacheable = false; // already cached
+				ts.cache_hits++;
+			} else if (!(use_mmap ? job->data.map(pdf_path) : job->data.read(pdf_path, buffers))) {
+				ts.read_errors++;
+				sf->fileErrors.push_back(FileError{ job->pdf_path_str, FileError::Kind::read, "" });
+				fail_read(*job);
+				continue;
+			}
+			if (!job->data.empty()) // a scan costs far less than letting Poppler find out there's no text
+				job->text_hint = pdf::text_hint(std::string_view(job->data.data(), job->data.size()));
+			ts.read_time += seconds_since(read_start);
+			ts.files++;
+			ts.bytes += job->data.size();
+
+			auto push_start = StatsClock::now();
+			bool pushed = queue.push(std::move(job));
+			ts.idle_time += seconds_since(push_start); // extraction is behind
+			if (!pushed)
+				break; // aborted
+		}
+		if (--active_readers == 0)
+			for (auto& q : loaded) q->close();
+	}
+
+	// --- Extract stage ---
+
+	std::unique_ptr<poppler::document> load_document(const FileJob& job) {
+		try {
+			if (job.data.empty() || job.data.size() > size_t(INT_MAX))
+				return std::unique_ptr<poppler::document>(poppler::document::load_from_file(job.pdf_path_str));
+			// The job keeps the buffer alive as long as any document created from it
+			return std::unique_ptr<poppler::document>(poppler::document::load_from_raw_data(job.data.data(), int(job.data.size())));
+		} catch (...) {
+			return nullptr;
+		}
+	}
+
+	// Hands a page to the matcher stage, or matches it right here without matcher threads
+	void emit_page(ThreadStats& ts, const std::shared_ptr<FileJob>& job, int page, std::string text) {
+		if (extracted) {
+			auto push_start = StatsClock::now();
+			bool pushed = extracted->push(PageText{ job, page, std::move(text) });
+			ts.idle_time += seconds_since(push_start); // matchers are behind
+			if (!pushed) { // aborted
+				job->incomplete = true;
+				finish_pages(ts, *job, 1);
+			}
+			return;
+		}
+		match_text(ts, *job, page, std::move(text));
+	}
+
+	bool past_deadline(const FileJob& job) const {
+		int64_t deadline = job.deadline_ns.load(std::memory_order_relaxed);
+		return deadline && StatsClock::now().time_since_epoch().count() >= deadline;
+	}
+
+	// Records that the file ran out of time, once
+	void time_out(FileJob& job) {
+		job.incomplete = true;
+		if (!job.timed_out.exchange(true))
+			sf->fileErrors.push_back(FileError{ job.pdf_path.u8string(), FileError::Kind::timeout, "over " + format_seconds(file_timeout) + " s" });
+	}
+
+	static std::string format_seconds(double s) {
+		std::ostringstream out;
+		out << s;
+		return out.str();
+	}
+
+	void search_range(ThreadStats& ts, const std::shared_ptr<FileJob>& job, int begin, int end, poppler::document& doc) {
+		for (int n = begin; n < end; ++n) {
+			if (sf->aborted) {
+				job->incomplete = true;
+				finish_pages(ts, *job, end - n);
+				return;
+			}
+			if (job->timed_out || past_deadline(*job)) {
+				time_out(*job);
+				finish_pages(ts, *job, end - n);
+				return;
+			}
+			if (max_count && job->hits >= max_count) {
+				job->skipped_pages = true;
+				finish_pages(ts, *job, end - n);
+				return;
+			}
+			int i = job->page_at(n);
+			auto page_start = StatsClock::now();
+			auto page = i < job->page_count ? std::unique_ptr<poppler::page>(doc.create_page(i)) : nullptr;
+			auto text_start = StatsClock::now();
+			ts.page_time += std::chrono::duration<double>(text_start - page_start).count();
+			if (!page) {
+				ts.page_errors++;
+				finish_pages(ts, *job, 1);
+				continue;
+			}
+			poppler::ustring utf16 = page->text(region);
+			std::string text = text_buffers.acquire(utf16.size()); // ASCII fits, transcoding grows it otherwise
+			pdf::utf16_to_utf8(utf16, text);
+			auto text_end = StatsClock::now();
+			ts.text_time += std::chrono::duration<double>(text_end - text_start).count();
+			ts.pages++;
+			ts.text_bytes += text.size();
+			job->busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(text_end - page_start).count();
+			emit_page(ts, job, i, std::move(text));
+		}
+	}
+
+	// Loads the document of a job, counted as the job's time
+	std::unique_ptr<poppler::document> timed_load(ThreadStats& ts, FileJob& job) {
+		auto load_start = StatsClock::now();
+		auto doc = load_document(job);
+		auto load_end = StatsClock::now();
+		ts.load_time += std::chrono::duration<double>(load_end - load_start).count();
+		job.busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(load_end - load_start).count();
+		return doc;
+	}
 
-				if (!doc) {
-					sf->completed_files++;
-					continue;
+	// Positions to search, recorded as an error if --max-pages leaves some out
+	int limit_pages(FileJob& job) {
+		int positions = job.positions();
+		if (positions < job.listed()) {
+			sf->fileErrors.push_back(FileError{ job.pdf_path_str, FileError::Kind::page_limit,
+				std::to_string(positions) + " of " + std::to_string(job.listed()) + " pages searched" });
+			job.cacheable = false; // partial extraction
+		}
+		return positions;
+	}
+
+	// Completes a file that has no text without extracting anything
+	void skip_no_text(ThreadStats& ts, FileJob& job) {
+		ts.no_text++;
+		sf->noTextPaths.push_back(job.pdf_path.u8string());
+		if (job.cacheable) job.extracted_pages.assign(job.page_count, std::string()); // cached as text-less
+		job.remaining_pages = 1;
+		finish_pages(ts, job, 1);
+	}
+
+	// Starts a prefetched file. Small documents are searched right away, large ones are split into
+	// page ranges: the first is searched here, the rest is queued for this and other threads.
+	void open_file(size_t worker, ThreadStats& ts, const std::shared_ptr<FileJob>& job, std::shared_ptr<FileJob>& doc_job, std::unique_ptr<poppler::document>& doc) {
+		job->result = add_result(job->pdf_path, job->file_index);
+		job->max_pages = max_pages;
+		if (file_timeout > 0)
+			job->deadline_ns = (StatsClock::now() + std::chrono::duration_cast<StatsClock::duration>(std::chrono::duration<double>(file_timeout))).time_since_epoch().count();
+		ts.files++;
+
+		if (job->cache_hit) {
+			job->page_count = (int)job->cached_pages.size();
+			if (std::all_of(job->cached_pages.begin(), job->cached_pages.end(), [](const std::string& p) { return p.empty(); })) {
+				skip_no_text(ts, *job);
+				return;
+			}
+			int positions = limit_pages(*job);
+			job->remaining_pages = positions + 1; // held until all pages are handed out
+			for (int n = 0; n < positions; ++n) {
+				int i = job->page_at(n);
+				if (i < job->page_count && !sf->aborted && !(max_count && job->hits >= max_count))
+					emit_page(ts, job, i, std::move(job->cached_pages[i]));
+				else
+					finish_pages(ts, *job, 1);
+			}
+			finish_pages(ts, *job, 1);
+			return;
+		}
+
+		if (job->text_hint == pdf::TextHint::none) {
+			skip_no_text(ts, *job);
+			return;
+		}
+		auto loaded_doc = timed_load(ts, *job);
+		if (!loaded_doc) {
+			ts.load_errors++;
+			if (!job->timed_out) // else the watchdog gave up on it meanwhile
+				sf->fileErrors.push_back(FileError{ job->pdf_path_str, FileError::Kind::load, "" });
+			job->incomplete = true;
+			job->remaining_pages = 1;
+			finish_pages(ts, *job, 1);
+			return;
+		}
+		if (job->text_hint == pdf::TextHint::unknown) {
+			// Font resources only, much cheaper than creating the pages and extracting nothing
+			auto scan_start = StatsClock::now();
+			bool fonts = pdf::has_fonts(*loaded_doc);
+			ts.load_time += seconds_since(scan_start);
+			if (!fonts) {
+				job->page_count = loaded_doc->pages();
+				skip_no_text(ts, *job);
+				return;
+			}
+		}
+		doc = std::move(loaded_doc);
+		doc_job = job;
+		job->page_count = doc->pages();
+		int positions = limit_pages(*job);
+		if (job->only_pages) job->cacheable = false; // partial extraction
+		if (job->cacheable) job->extracted_pages.resize(job->page_count);
+
+		if (positions == 0) {
+			job->remaining_pages = 1;
+			finish_pages(ts, *job, 1);
+			return;
+		}
+		job->remaining_pages = positions;
+
+		int range_pages = positions;
+		if (num_threads > 1 && positions >= split_min_pages && !max_count) // -m wants the first hits in page order
+			range_pages = std::max(min_range_pages, positions / int(num_threads * 4));
+		for (int begin = range_pages; begin < positions; begin += range_pages) {
+			pending++;
+			queues[worker].push(PageRange{ job, begin, std::min(begin + range_pages, positions) });
+		}
+
+		search_range(ts, job, 0, std::min(range_pages, positions), *doc);
+	}
+
+	// Searches a queued range, reusing the open document when it belongs to the same file
+	void run_range(ThreadStats& ts, const PageRange& r, std::shared_ptr<FileJob>& doc_job, std::unique_ptr<poppler::document>& doc) {
+		if (doc_job != r.job) {
+			doc.reset();
+			doc_job.reset();
+			doc = timed_load(ts, *r.job);
+			if (doc) doc_job = r.job;
+		}
+		if (doc) {
+			search_range(ts, r.job, r.begin, r.end, *doc);
+		} else {
+			ts.load_errors++;
+			r.job->incomplete = true;
+			finish_pages(ts, *r.job, r.end - r.begin);
+		}
+	}
+
+	// NUMA node of an extract thread, threads are spread over the nodes in contiguous blocks
+	size_t node_of(size_t worker) const { return worker * nodes.size() / num_threads; }
+
+	// CPUs an extract thread is bound to with --pin, one of its node
+	std::vector<int> extract_cpus(size_t worker) const {
+		if (!pin) return {};
+		size_t node = node_of(worker);
+		size_t first = (node * num_threads + nodes.size() - 1) / nodes.size(); // first worker of the node
+		const auto& cpus = nodes[node];
+		return { cpus[(worker - first) % cpus.size()] };
+	}
+
+	// Ranges of threads on the same node first, their pages are likely still in that node's caches and memory
+	bool steal(size_t worker, PageRange& r) {
+		for (int same_node = 1; same_node >= 0; --same_node)
+			for (size_t k = 1; k < num_threads; ++k) {
+				size_t victim = (worker + k) % num_threads;
+				if ((node_of(victim) == node_of(worker)) == bool(same_node) && queues[victim].steal(r))
+					return true;
+			}
+		return false;
+	}
+
+	// Next prefetched file, from the thread's own node first. Only that one is waited for, drained tells whether
+	// all readers are done and every queue is empty.
+	bool pop_loaded(size_t worker, std::shared_ptr<FileJob>& job, std::chrono::milliseconds timeout, bool& drained) {
+		size_t node = loaded.size() > 1 ? node_of(worker) : 0;
+		drained = true;
+		for (size_t k = 0; k < loaded.size(); ++k) {
+			bool queue_drained = false;
+			if (loaded[(node + k) % loaded.size()]->pop_for(job, k == 0 ? timeout : std::chrono::milliseconds(0), queue_drained)) {
+				drained = false;
+				return true;
+			}
+			drained = drained && queue_drained;
+		}
+		return false;
+	}
+
+	// Publishes the file the thread works on to the watchdog, unless the thread was replaced
+	void track(size_t worker, unsigned generation, const std::shared_ptr<FileJob>& job) {
+		if (!slots) return;
+		std::lock_guard<std::mutex> lock(slots[worker].mtx);
+		if (slots[worker].generation == generation)
+			slots[worker].job = job;
+	}
+
+	bool replaced(size_t worker, unsigned generation) {
+		if (!slots) return false;
+		std::lock_guard<std::mutex> lock(slots[worker].mtx);
+		return slots[worker].generation != generation;
+	}
+
+	void extract_files(size_t worker, ThreadStats& slot_stats) {
+		ThreadStats ts; // added to slot_stats at the end, a replaced thread may still add to it afterwards
+		unsigned generation = 0;
+		if (slots) {
+			std::lock_guard<std::mutex> lock(slots[worker].mtx);
+			generation = slots[worker].generation;
+		}
+		std::shared_ptr<FileJob> doc_job; // file of the open document
+		std::unique_ptr<poppler::document> doc;
+
+		// Counted in pending while a file is taken and opened, others must not quit meanwhile
+		auto take_file = [&](std::chrono::milliseconds timeout, bool& drained) {
+			std::shared_ptr<FileJob> job;
+			pending++;
+			auto wait_start = StatsClock::now();
+			bool got = pop_loaded(worker, job, timeout, drained);
+			ts.idle_time += seconds_since(wait_start);
+			if (got) {
+				track(worker, generation, job);
+				open_file(worker, ts, job, doc_job, doc);
+				track(worker, generation, nullptr);
+			}
+			pending--;
+			return got;
+		};
+		auto run_tracked = [&](const PageRange& r) {
+			track(worker, generation, r.job);
+			run_range(ts, r, doc_job, doc);
+			track(worker, generation, nullptr);
+		};
+
+		while (!sf->aborted) {
+			if (replaced(worker, generation)) {
+				// Back from a document the watchdog gave up on, the replacement owns the queue now
+				doc.reset();
+				std::lock_guard<std::mutex> lock(stats_mtx);
+				slot_stats.merge(ts);
+				hung--;
+				return;
+			}
+			// Own ranges first, then new files, then ranges of other threads
+			PageRange r;
+			bool drained = false;
+			if (queues[worker].pop(r)) {
+				pending--;
+				run_tracked(r);
+			} else if (take_file(std::chrono::milliseconds(0), drained)) {
+			} else if (steal(worker, r)) {
+				pending--;
+				run_tracked(r);
+			} else if (drained && pending == 0) {
+				break; // No more files or ranges to process
+			} else {
+				take_file(std::chrono::milliseconds(1), drained); // wait for the readers or another thread opening a file
+			}
+		}
+		doc.reset();
+		if (replaced(worker, generation)) { // aborted while it hung
+			std::lock_guard<std::mutex> lock(stats_mtx);
+			slot_stats.merge(ts);
+			hung--;
+			return;
+		}
+		// Ranges left behind by an abort still complete their files
+		PageRange r;
+		while (queues[worker].pop(r)) {
+			r.job->incomplete = true;
+			finish_pages(ts, *r.job, r.end - r.begin);
+		}
+		{
+			std::lock_guard<std::mutex> lock(stats_mtx);
+			slot_stats.merge(ts);
+		}
+		if (--active_extractors == 0 && extracted)
+			extracted->close();
+	}
+
+	// --- Watchdog ---
+
+	// With --file-timeout: gives up on files an extract thread is stuck in past their deadline. Poppler can't be
+	// interrupted, so the file's result is completed as timed out and another thread takes over the stuck one's
+	// work; the stuck thread quits once Poppler returns.
+	void watchdog() {
+		auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>(file_timeout / 4));
+		interval = std::min(std::max(interval, std::chrono::milliseconds(10)), std::chrono::milliseconds(100));
+		while (!sf->aborted && active_extractors > 0) {
+			std::this_thread::sleep_for(interval);
+			for (size_t w = 0; w < num_threads; ++w) {
+				std::shared_ptr<FileJob> job;
+				{
+					std::lock_guard<std::mutex> lock(slots[w].mtx);
+					job = slots[w].job;
 				}
-				std::shared_ptr<SearchResult> current_res = std::make_shared<SearchResult>();
-				//current_res->pdf_path = pdf_path;
-				current_res->setPdfPath(pdf_path);
+				if (!job || !past_deadline(*job) || job->completed.exchange(true))
+					continue; // idle, in time, or just done
+				time_out(*job);
+				complete_file(nullptr, *job);
 				{
-					std::lock_guard<std::mutex> lock(sf->results_mutex);
-					sf->results.push_back(current_res);
+					std::lock_guard<std::mutex> lock(slots[w].mtx);
+					slots[w].generation++;
+					slots[w].job.reset();
 				}
+				hung++;
+				launch([this, w]() { extract_files(w, thread_stats[num_readers + w]); }, extract_cpus(w));
+			}
+		}
+	}
 
-				int pages = doc->pages();
-				for (int i = 0; i < pages && !sf->aborted; ++i) {
-					auto page = std::unique_ptr<poppler::page>(doc->create_page(i));
-					if (!page) continue;
-					auto utf8 = page->text().to_utf8();
-					std::string page_text(utf8.data(), utf8.size());
-					std::istringstream iss(page_text);
-					std::string line;
-					int line_number = 0;
-					while (std::getline(iss, line)) {
-						++line_number;
-						if (pdf::tolower(line).find(targetLower) != std::string::npos) {
-							Occurence occurrence{ i + 1, line_number, line };
-							// Add occurrence directly to shared SearchResult
-							current_res->addOccurrence(occurrence);
-							//current_res->occurences.push_back(occurrence); //TODO(remove)
-							// Notify the main thread that there's an update.
-							// This notification is what allows the main thread to pick up incremental page findings.
-							sf->queue_cv.notify_one();
-						}
-					}
-				}
+	// --- Matcher stage ---
 
-				// After processing all pages for this PDF
-				{
-					//current_res->completed = true; //TODO(remove)
-					current_res->setCompleted(true);
-					sf->completed_files++;
-					sf->queue_cv.notify_one(); // Notify main thread that this file is fully completed
-				}
+	void match_text(ThreadStats& ts, FileJob& job, int page, std::string text) {
+		auto match_start = StatsClock::now();
+		match_page(page, text, job, ts);
+		auto match_end = StatsClock::now();
+		ts.match_time += std::chrono::duration<double>(match_end - match_start).count();
+		if (extracted) ts.pages++; // on the extract threads the page was already counted there
+		job.busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(match_end - match_start).count();
+		if (job.cacheable) job.extracted_pages[page] = std::move(text);
+		else text_buffers.release(std::move(text)); // occurrences keep their own copy of the line
+		finish_pages(ts, job, 1);
+	}
 
-				delete doc; // Clean up Poppler document
+	void match_pages(ThreadStats& ts) {
+		PageText item;
+		while (true) {
+			auto wait_start = StatsClock::now();
+			bool got = extracted->pop(item);
+			ts.idle_time += seconds_since(wait_start);
+			if (!got)
+				break;
+			if (!sf->aborted) {
+				match_text(ts, *item.job, item.page, std::move(item.text));
+			} else {
+				item.job->incomplete = true;
+				finish_pages(ts, *item.job, 1);
 			}
-		};
+			item.job.reset();
+		}
+	}
+
+	// The last page of a file completes its result, unless the watchdog did so before
+	void finish_pages(ThreadStats& ts, FileJob& job, int count) {
+		if ((job.remaining_pages -= count) > 0)
+			return;
+		if (!job.completed.exchange(true))
+			complete_file(&ts, job);
+	}
+
+	// Called once per file, ts is null for the watchdog
+	void complete_file(ThreadStats* ts, FileJob& job) {
+		if (ts)
+			ts->addFile(FileTiming{ job.pdf_path_str, job.page_count, job.busy_ns * 1e-9 });
+		if (!job.incomplete && job.cacheable && !job.skipped_pages) // don't cache aborted, timed out or partial extractions
+			sf->textCache->store(job.key, job.extracted_pages);
 
-		// --- Launch worker threads ---
-		size_t num_threads = std::max<size_t>(1, std::thread::hardware_concurrency() - 1);
-		for (size_t i = 0; i < num_threads; ++i) {
-			pool.emplace_back(worker_func);
+		// Files cut short by an abort aren't shown, neither are matches beyond --limit
+		bool dropped = job.incomplete && sf->aborted;
+		bool stop = false;
+		if (limit && !dropped && job.result->occurrenceCount() > 0) {
+			size_t matched = ++sf->matched_files;
+			dropped = matched > limit;
+			stop = matched == limit;
+		}
+		// --top keeps the file if it is among the best so far, the others are released as they complete
+		if (sf->top && !dropped && job.result->occurrenceCount() > 0) {
+			double bm25 = job.file_index < sf->fileScores.size() ? sf->fileScores[job.file_index] : 0;
+			dropped = !sf->top->offer(sf->top->score(job.result->occurrenceCount(), job.page_count, bm25), job.result);
 		}
+
+		// After processing all pages for this PDF
+		job.result->complete(dropped); // ranges and matchers may have finished out of order
+
+		sf->completed_files++;
+		sf->notifyUpdate(); // Notify main thread that this file is fully completed
+		if (stop) {
+			sf->aborted = true;
+			abort();
+		}
+	}
+
+	// Wakes up every stage after sf->aborted was set
+	void abort() {
+		sf->wakeFileWaiters();
+		for (auto& q : loaded) q->close();
+		if (extracted) extracted->close();
+	}
+
+	// Compiles the search words, returns false with a message if a regular expression is invalid
+	bool build_matcher(std::string& error) {
+		folder = TextFolder(normalize, join_lines);
+		if (regex) {
+			// RE2 folds case itself, pages only need folding to be normalized
+			fold_pages = normalize || join_lines;
+			std::vector<std::string> patterns;
+			for (const auto& w : sf->searchWords)
+				patterns.push_back(normalize ? folder.fold(w, false) : w);
+			auto re = std::make_unique<RegexPageMatcher>(patterns);
+			error = re->error();
+			if (!error.empty())
+				return false;
+			matcher = std::move(re);
+			return true;
+		}
+		std::vector<std::string> patterns;
+		fold_pages = false;
+		for (const auto& w : sf->searchWords) {
+			patterns.push_back(folder.fold(w));
+			fold_pages = fold_pages || folder.affects(patterns.back());
+		}
+		if (patterns.size() == 1)
+			matcher = std::make_unique<LiteralPageMatcher>(patterns[0]);
+		else
+			matcher = std::make_unique<AhoCorasickMatcher>(patterns);
+		return true;
+	}
+
+	void search() {
+		std::string error;
+		if (!matcher && !build_matcher(error)) {
+			sf->aborted = true; // nothing to search with, callers check build_matcher() beforehand
+			return;
+		}
+
+		if (num_threads == 0)
+			num_threads = std::max<size_t>(1, std::thread::hardware_concurrency() - 1);
+		if (max_count)
+			num_matchers = 0; // match right after extraction, so extraction stops as soon as enough was found
+		nodes = pin ? cpu::numa_nodes() : std::vector<std::vector<int>>(1);
+		nodes.resize(std::min(nodes.size(), num_threads)); // every node gets extract threads
+		num_readers = std::max<size_t>(pin ? nodes.size() : 1, num_readers); // and a reader filling its queue
+		if (read_queue_depth == 0)
+			read_queue_depth = std::max<size_t>(2, num_threads);
+		loaded.clear();
+		for (size_t n = 0; n < nodes.size(); ++n)
+			loaded.push_back(std::make_unique<BoundedQueue<std::shared_ptr<FileJob>>>((read_queue_depth + n) / nodes.size()));
+		buffers.setMaxBuffers(read_queue_depth + num_threads + num_readers); // queued, being extracted, being read
+		text_buffers.setMaxBuffers(2 * (num_threads + num_matchers) + 8); // being extracted or matched, plus a few queued
+		if (num_matchers)
+			extracted = std::make_unique<BoundedQueue<PageText>>(match_queue_depth);
+		queues.reset(new WorkDeque<PageRange>[num_threads]);
+		if (file_timeout > 0)
+			slots.reset(new ExtractSlot[num_threads]);
+
+		// --- Launch pipeline threads ---
+		active_readers = num_readers;
+		active_extractors = num_threads;
+		thread_stats.assign(num_readers + num_threads + num_matchers, ThreadStats());
+		ThreadStats* ts = thread_stats.data();
+		// With --pin readers and matchers may run anywhere on their node, the extract threads on one CPU each
+		auto node_cpus = [&](size_t i) { return pin ? nodes[i % nodes.size()] : std::vector<int>(); };
+		for (size_t i = 0; i < num_readers; ++i)
+			launch([this, i, &s = *ts++]() { read_files(i, s); }, node_cpus(i));
+		for (size_t i = 0; i < num_threads; ++i)
+			launch([this, i, &s = *ts++]() { extract_files(i, s); }, extract_cpus(i));
+		for (size_t i = 0; i < num_matchers; ++i)
+			launch([this, &s = *ts++]() { match_pages(s); }, node_cpus(i));
+		if (slots)
+			launch([this]() { watchdog(); });
 	}
 };
@@ -1,21 +1,111 @@
 #pragma once
 
 #include "SearchResult.hpp"
+#include "TextCache.hpp"
+#include "TopK.hpp"
+
+// A file that couldn't be searched completely, listed next to erroredPaths
+struct FileError {
+	enum class Kind {
+		read,       // the file couldn't be read
+		load,       // Poppler couldn't open the document
+		timeout,    // --file-timeout ran out, the pages searched until then are shown
+		page_limit, // longer than --max-pages, the pages after the limit weren't searched
+	};
+	std::string path; // UTF-8
+	Kind kind;
+	std::string detail;
+
+	static const char* name(Kind kind) {
+		switch (kind) {
+		case Kind::read: return "read";
+		case Kind::load: return "load";
+		case Kind::timeout: return "timeout";
+		case Kind::page_limit: return "page_limit";
+		}
+		return "";
+	}
+};
 
 struct SearchedFiles {
-	std::string searchWord;
-	std::vector<fs::path> pdfFileNames;
+	std::vector<std::string> searchWords;
+	std::vector<fs::path> pdfFileNames; // guarded by files_mutex while a streaming walk appends to it
+	std::vector<std::vector<int>> candidatePages; // index query mode: zero based pages to scan per file, empty = all pages
+	std::vector<double> fileScores; // index query mode with --rank bm25: score per file, best first
+	std::unique_ptr<TopK> top; // --top, null without; the completed results it keeps are the output
 	
-	std::vector<std::string> erroredPaths; //TODO make SearchResult with error instead
+	AppendList<std::string> erroredPaths; // paths that aren't representable, see fileErrors for everything else
+	AppendList<FileError> fileErrors;
+	AppendList<std::string> noTextPaths; // skipped, image only or without any font
+
+	std::mutex files_mutex;
+	std::condition_variable files_cv;
+	std::atomic<size_t> total_files{ 0 }; // grows during a streaming walk
+	std::atomic<bool> walk_done{ true }; // false while a streaming walk may still add files
 
-	size_t total_files = 0;
+	std::shared_ptr<TextCache> textCache; // null when caching is disabled, may be shared by concurrent searches
 
-	std::vector<std::shared_ptr<SearchResult>> results;
-	std::mutex results_mutex; // Mutex to protect 'results' vector modifications
+	AppendList<std::shared_ptr<SearchResult>> results; // in the order files were opened, read by the printer without locking
 
 	std::condition_variable queue_cv; // Condition variable to signal updates to main thread
 
-	std::atomic<size_t> file_index{ 0 }; // Atomic counter for files to be processed by workers
-	std::atomic<size_t> completed_files{ 0 }; // Atomic counter for completed files
-	std::atomic<bool> aborted{ false }; // Flag to signal threads to stop
+	// The counters every thread touches get a cache line each, so writing one doesn't evict the others
+	// (and aborted, which every stage polls) from the caches of all threads
+	alignas(64) std::atomic<uint64_t> updates{ 0 }; // bumped on every change the display shows, the printer redraws when it moved
+	std::atomic<int64_t> last_progress{ 0 }; // steady_clock time of the last notifyProgress() that notified
+	alignas(64) std::atomic<size_t> file_index{ 0 }; // Atomic counter for files to be processed by workers
+	alignas(64) std::atomic<size_t> completed_files{ 0 }; // Atomic counter for completed files
+	std::atomic<size_t> matched_files{ 0 }; // completed files with occurrences, counted for --limit
+	alignas(64) std::atomic<bool> aborted{ false }; // Flag to signal threads to stop
+
+	// Occurrences found within a file are shown at most this often, the completion of a file notifies right away
+	static constexpr int64_t progress_interval_ns = 5'000'000;
+
+	// Appends files found by a streaming walk
+	void addFiles(std::vector<fs::path>& files) {
+		std::lock_guard<std::mutex> lock(files_mutex);
+		pdfFileNames.insert(pdfFileNames.end(), std::make_move_iterator(files.begin()), std::make_move_iterator(files.end()));
+		total_files = pdfFileNames.size();
+		files_cv.notify_all();
+		notifyUpdate();
+	}
+
+	void finishWalk() {
+		std::lock_guard<std::mutex> lock(files_mutex);
+		walk_done = true;
+		files_cv.notify_all();
+		notifyUpdate();
+	}
+
+	// Tells the printer that new occurrences, completed files or found files are waiting
+	void notifyUpdate() {
+		updates.fetch_add(1, std::memory_order_release);
+		queue_cv.notify_one();
+	}
+
+	// notifyUpdate() for occurrences of a file that isn't complete yet, batched: however many threads find
+	// something, only one of them notifies per progress interval. What falls in between is picked up by the
+	// next notification or, at the latest, by the printer's wait timeout.
+	void notifyProgress() {
+		int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		int64_t last = last_progress.load(std::memory_order_relaxed);
+		if (now - last < progress_interval_ns || !last_progress.compare_exchange_strong(last, now, std::memory_order_relaxed))
+			return;
+		notifyUpdate();
+	}
+
+	// Waits until file idx was found or the walk is over. Returns false if there is no such file.
+	bool getFile(size_t idx, fs::path& path) {
+		std::unique_lock<std::mutex> lock(files_mutex);
+		files_cv.wait(lock, [&]() { return idx < pdfFileNames.size() || walk_done || aborted; });
+		if (idx >= pdfFileNames.size() || aborted)
+			return false;
+		path = pdfFileNames[idx];
+		return true;
+	}
+
+	void wakeFileWaiters() {
+		std::lock_guard<std::mutex> lock(files_mutex);
+		files_cv.notify_all();
+	}
 };
\ No newline at end of file
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "util.hpp"
+
+// Run statistics for --stats. Every pipeline thread only writes its own ThreadStats, so counting costs
+// no synchronization; the threads are summed up per stage after they were joined.
+
+using StatsClock = std::chrono::steady_clock;
+
+inline double seconds_since(StatsClock::time_point start) {
+	return std::chrono::duration<double>(StatsClock::now() - start).count();
+}
+
+struct FileTiming {
+	std::string path;
+	int pages = 0;
+	double seconds = 0; // load, extraction and matching, summed over the threads that worked on the file
+};
+
+// Counters of one thread, padded so neighbouring threads don't share a cache line
+struct alignas(64) ThreadStats {
+	static constexpr size_t slowest_count = 10;
+
+	uint64_t files = 0;       // read (reader) or opened (extract)
+	uint64_t cache_hits = 0;
+	uint64_t pages = 0;       // extracted (extract) or matched (matcher)
+	uint64_t bytes = 0;       // PDF bytes read
+	uint64_t text_bytes = 0;  // extracted text
+	uint64_t occurrences = 0;
+	uint64_t no_text = 0;     // files skipped without extraction, they have no text (see SearchedFiles::noTextPaths)
+	uint64_t pruned = 0;      // files skipped unread, their index score can't make the --top
+
+	uint64_t path_errors = 0; // path not representable, see SearchedFiles::erroredPaths
+	uint64_t read_errors = 0;
+	uint64_t load_errors = 0; // Poppler couldn't open the document
+	uint64_t page_errors = 0; // create_page failed
+
+	double read_time = 0;
+	double load_time = 0;     // load_from_raw_data / load_from_file
+	double page_time = 0;     // create_page
+	double text_time = 0;     // page::text and the UTF-8 conversion
+	double match_time = 0;
+	double idle_time = 0;     // waiting for input or for room in the next queue
+
+	std::vector<FileTiming> slowest; // min-heap on seconds, at most slowest_count
+
+	void addFile(FileTiming t) {
+		auto faster = [](const FileTiming& a, const FileTiming& b) { return a.seconds > b.seconds; };
+		if (slowest.size() == slowest_count) {
+			if (t.seconds <= slowest.front().seconds) return;
+			std::pop_heap(slowest.begin(), slowest.end(), faster);
+			slowest.pop_back();
+		}
+		slowest.push_back(std::move(t));
+		std::push_heap(slowest.begin(), slowest.end(), faster);
+	}
+
+	void merge(const ThreadStats& o) {
+		files += o.files;
+		cache_hits += o.cache_hits;
+		pages += o.pages;
+		bytes += o.bytes;
+		text_bytes += o.text_bytes;
+		occurrences += o.occurrences;
+		no_text += o.no_text;
+		pruned += o.pruned;
+		path_errors += o.path_errors;
+		read_errors += o.read_errors;
+		load_errors += o.load_errors;
+		page_errors += o.page_errors;
+		read_time += o.read_time;
+		load_time += o.load_time;
+		page_time += o.page_time;
+		text_time += o.text_time;
+		match_time += o.match_time;
+		idle_time += o.idle_time;
+		for (const auto& t : o.slowest) addFile(t);
+	}
+};
+
+// Totals of a run, written after all threads were joined
+struct RunStats {
+	double wall_time = 0;
+	double walk_time = 0;
+	double output_time = 0; // building and writing the result display
+	uint64_t spilled_bytes = 0; // output held back by --sort that went to a temporary file
+	ThreadStats readers, extractors, matchers, total;
+	std::vector<double> idle; // per thread, readers first, then extractors, then matchers
+	size_t num_readers = 0, num_threads = 0, num_matchers = 0;
+	size_t timeouts = 0; // files given up on after --file-timeout, from SearchedFiles::fileErrors
+
+	static double per_s(double amount, double seconds) { return seconds > 0 ? amount / seconds : 0; }
+
+	// Per stage sums, the threads are laid out like idle
+	void collect(const std::vector<ThreadStats>& threads, size_t readers_n, size_t extractors_n) {
+		num_readers = readers_n;
+		num_threads = extractors_n;
+		num_matchers = threads.size() - readers_n - extractors_n;
+		for (size_t i = 0; i < threads.size(); ++i) {
+			ThreadStats& stage = i < readers_n ? readers : i < readers_n + extractors_n ? extractors : matchers;
+			stage.merge(threads[i]);
+			total.merge(threads[i]);
+			idle.push_back(threads[i].idle_time);
+		}
+		std::sort_heap(total.slowest.begin(), total.slowest.end(), [](const FileTiming& a, const FileTiming& b) { return a.seconds > b.seconds; });
+	}
+
+	void print(std::ostream& out) const {
+		auto mb = [](uint64_t bytes) { return bytes / 1e6; };
+		out << std::fixed << std::setprecision(3)
+			<< "\nstats:\n"
+			<< "  wall      " << wall_time << " s, walk " << walk_time << " s, output " << output_time << " s, "
+			<< mb(spilled_bytes) << " MB spilled\n"
+			<< "  threads   " << num_readers << " readers, " << num_threads << " extract, " << num_matchers << " matchers\n"
+			<< "  files     " << readers.files << " read (" << total.cache_hits << " cached), " << mb(total.bytes) << " MB, "
+			<< per_s(mb(total.bytes), wall_time) << " MB/s\n"
+			<< "  pages     " << extractors.pages << " extracted, " << mb(total.text_bytes) << " MB text, "
+			<< per_s(double(extractors.pages), wall_time) << " pages/s, " << total.occurrences << " occurrences\n"
+			<< "  skipped   " << total.no_text << " files without text, " << total.pruned << " pruned by --top\n"
+			<< "  time      read " << total.read_time << " s, load " << total.load_time << " s, create_page " << total.page_time
+			<< " s, text " << total.text_time << " s, match " << total.match_time << " s (summed over threads)\n"
+			<< "  idle      readers " << readers.idle_time << " s, extract " << extractors.idle_time << " s, matchers " << matchers.idle_time << " s\n"
+			<< "  errors    path " << total.path_errors << ", read " << total.read_errors << ", load " << total.load_errors
+			<< ", page " << total.page_errors << ", timeout " << timeouts << "\n";
+		if (!total.slowest.empty())
+			out << "  slowest files:\n";
+		for (const auto& t : total.slowest)
+			out << "    " << std::setw(8) << t.seconds << " s " << std::setw(6) << t.pages << " pages  " << t.path << "\n";
+	}
+
+	void printJson(std::ostream& out) const {
+		auto stage = [&](const char* name, const ThreadStats& s, size_t threads) {
+			out << "    " << json::quote(name) << ": { \"threads\": " << threads << ", \"files\": " << s.files
+				<< ", \"cache_hits\": " << s.cache_hits << ", \"pages\": " << s.pages << ", \"bytes\": " << s.bytes
+				<< ", \"text_bytes\": " << s.text_bytes << ", \"occurrences\": " << s.occurrences
+				<< ", \"read_s\": " << s.read_time << ", \"load_s\": " << s.load_time << ", \"create_page_s\": " << s.page_time
+				<< ", \"text_s\": " << s.text_time << ", \"match_s\": " << s.match_time << ", \"idle_s\": " << s.idle_time << " }";
+		};
+		out << std::fixed << std::setprecision(6)
+			<< "{\n"
+			<< "  \"wall_s\": " << wall_time << ",\n"
+			<< "  \"walk_s\": " << walk_time << ",\n"
+			<< "  \"output_s\": " << output_time << ",\n"
+			<< "  \"spilled_bytes\": " << spilled_bytes << ",\n"
+			<< "  \"pages_per_s\": " << per_s(double(extractors.pages), wall_time) << ",\n"
+			<< "  \"mb_per_s\": " << per_s(total.bytes / 1e6, wall_time) << ",\n"
+			<< "  \"stages\": {\n";
+		stage("read", readers, num_readers);
+		out << ",\n";
+		stage("extract", extractors, num_threads);
+		out << ",\n";
+		stage("match", matchers, num_matchers);
+		out << "\n  },\n"
+			<< "  \"skipped\": { \"no_text\": " << total.no_text << ", \"pruned\": " << total.pruned << " },\n"
+			<< "  \"errors\": { \"path\": " << total.path_errors << ", \"read\": " << total.read_errors
+			<< ", \"load\": " << total.load_errors << ", \"page\": " << total.page_errors << ", \"timeout\": " << timeouts << " },\n"
+			<< "  \"thread_idle_s\": [";
+		for (size_t i = 0; i < idle.size(); ++i)
+			out << (i ? ", " : "") << idle[i];
+		out << "],\n"
+			<< "  \"slowest\": [";
+		for (size_t i = 0; i < total.slowest.size(); ++i) {
+			const auto& t = total.slowest[i];
+			out << (i ? "," : "") << "\n    { \"path\": " << json::quote(t.path) << ", \"pages\": " << t.pages << ", \"seconds\": " << t.seconds << " }";
+		}
+		out << (total.slowest.empty() ? "]\n" : "\n  ]\n") << "}\n";
+	}
+};
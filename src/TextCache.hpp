@@ -0,0 +1,168 @@
+#pragma once
+
+#include "util.hpp"
+
+#include <fstream>
+#include <shared_mutex>
+#include <unordered_map>
+
+// Identifies the state of a PDF on disk. A cache entry is only valid while all fields match.
+struct FileKey {
+	std::string path;
+	uint64_t size = 0;
+	int64_t mtime = 0;
+
+	bool operator==(const FileKey& o) const { return size == o.size && mtime == o.mtime && path == o.path; }
+	bool operator!=(const FileKey& o) const { return !(*this == o); }
+
+	static bool fromPath(const fs::path& p, FileKey& key) {
+		std::error_code ec;
+		key.path = fs::absolute(p, ec).u8string();
+		if (ec) return false;
+		key.size = fs::file_size(p, ec);
+		if (ec) return false;
+		auto t = fs::last_write_time(p, ec);
+		if (ec) return false;
+		key.mtime = t.time_since_epoch().count();
+		return true;
+	}
+};
+
+// On-disk cache of extracted per-page UTF-8 text, one file per PDF.
+// A hit lets the search skip Poppler entirely.
+// Long-running processes can keep the entries in memory as well, then a hit doesn't touch the disk either;
+// without a directory the cache lives in memory only.
+class TextCache {
+	fs::path directory; // empty: nothing is written to disk
+
+	struct MemoryEntry {
+		FileKey key;
+		std::shared_ptr<const std::vector<std::string>> pages;
+	};
+	bool in_memory;
+	mutable std::shared_mutex memory_mtx;
+	mutable std::unordered_map<std::string, MemoryEntry> memory; // by FileKey::path
+
+	static constexpr char magic[8] = { 'P','D','F','M','S','T','C','1' };
+
+	fs::path entryPath(const FileKey& key) const {
+		char name[17];
+		snprintf(name, sizeof(name), "%016llx", (unsigned long long)pdf::fnv1a(key.path));
+		return directory / (std::string(name) + ".txtc");
+	}
+
+	template<typename T>
+	static bool read_pod(std::istream& in, T& v) { return bool(in.read(reinterpret_cast<char*>(&v), sizeof(T))); }
+	template<typename T>
+	static void write_pod(std::ostream& out, const T& v) { out.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+	static bool read_string(std::istream& in, std::string& s) {
+		uint32_t len;
+		if (!read_pod(in, len)) return false;
+		s.resize(len);
+		return len == 0 || bool(in.read(&s[0], len));
+	}
+	static void write_string(std::ostream& out, const std::string& s) {
+		write_pod(out, uint32_t(s.size()));
+		out.write(s.data(), s.size());
+	}
+
+public:
+	TextCache(const fs::path& directory, bool in_memory = false) : directory(directory), in_memory(in_memory) {
+		std::error_code ec;
+		if (!directory.empty())
+			fs::create_directories(directory, ec);
+	}
+
+	const fs::path& getDirectory() const { return directory; }
+
+	// Fills pages with the cached text of the file described by key. Returns false on a miss or stale entry.
+	bool load(const FileKey& key, std::vector<std::string>& pages) const {
+		if (in_memory) {
+			std::shared_lock<std::shared_mutex> lock(memory_mtx);
+			auto it = memory.find(key.path);
+			if (it != memory.end() && it->second.key == key) {
+				pages = *it->second.pages;
+				return true;
+			}
+		}
+		if (directory.empty() || !load_file(key, pages))
+			return false;
+		if (in_memory)
+			remember(key, pages);
+		return true;
+	}
+
+	// Writes the entry to a temporary file first so concurrent readers never see a partial entry.
+	void store(const FileKey& key, const std::vector<std::string>& pages) const {
+		if (in_memory)
+			remember(key, pages);
+		if (!directory.empty())
+			store_file(key, pages);
+	}
+
+	// Drops the in-memory entry of a file that is gone, its disk entry just turns stale
+	void forget(const fs::path& path) const {
+		if (!in_memory) return;
+		std::error_code ec;
+		std::string key_path = fs::absolute(path, ec).u8string();
+		std::unique_lock<std::shared_mutex> lock(memory_mtx);
+		memory.erase(key_path);
+	}
+
+private:
+	void remember(const FileKey& key, const std::vector<std::string>& pages) const {
+		auto copy = std::make_shared<const std::vector<std::string>>(pages);
+		std::unique_lock<std::shared_mutex> lock(memory_mtx);
+		memory[key.path] = MemoryEntry{ key, std::move(copy) };
+	}
+
+	bool load_file(const FileKey& key, std::vector<std::string>& pages) const {
+		std::ifstream in(entryPath(key), std::ios::binary);
+		if (!in) return false;
+
+		char m[sizeof(magic)];
+		if (!in.read(m, sizeof(m)) || !std::equal(m, m + sizeof(m), magic))
+			return false;
+
+		FileKey stored;
+		if (!read_string(in, stored.path) || !read_pod(in, stored.size) || !read_pod(in, stored.mtime))
+			return false;
+		if (stored != key)
+			return false;
+
+		uint32_t count;
+		if (!read_pod(in, count))
+			return false;
+		pages.resize(count);
+		for (auto& p : pages)
+			if (!read_string(in, p))
+				return false;
+		return true;
+	}
+
+	void store_file(const FileKey& key, const std::vector<std::string>& pages) const {
+		fs::path target = entryPath(key);
+		fs::path tmp = pdf::temp_path(target);
+		{
+			std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+			if (!out) return;
+			out.write(magic, sizeof(magic));
+			write_string(out, key.path);
+			write_pod(out, key.size);
+			write_pod(out, key.mtime);
+			write_pod(out, uint32_t(pages.size()));
+			for (const auto& p : pages)
+				write_string(out, p);
+			if (!out) {
+				out.close();
+				std::error_code ec;
+				fs::remove(tmp, ec);
+				return;
+			}
+		}
+		std::error_code ec;
+		fs::rename(tmp, target, ec);
+		if (ec) fs::remove(tmp, ec);
+	}
+};
@@ -0,0 +1,313 @@
+#pragma once
+
+#include "FoldTables.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Unicode case folding of UTF-8 text, optionally with NFKC normalization (ligatures, fullwidth forms,
+// compatibility characters; "ß" and "ﬁ" become "ss" and "fi"). Normalization is per code point, decomposed
+// sequences aren't composed.
+// The generated runs are expanded once into a two-level table of UTF-8 replacements, so folding is one lookup
+// per non-ASCII code point. Pages folded for the matchers keep an OffsetMap back into the original text.
+// Joining (--join-lines) also makes phrases findable across line breaks in the same pass: runs of whitespace
+// become one space and a hyphen (or soft hyphen) that ends a line is dropped with the break, so "perfor-\nmance"
+// reads "performance". Hyphenated compounds broken at a line end are joined the same way.
+// Where the bytes of folded text come from in the original. Folding copies or replaces most text byte for byte,
+// so only the runs that continue linearly are stored, a new one starts where a whitespace run collapses, a line
+// break hyphen is dropped or a replacement changes the length. Typical pages need a few runs per line, not an
+// offset per byte.
+class OffsetMap {
+	std::vector<uint32_t> run_out{ 0 }, run_in{ 0 }; // start of each run in folded and original text
+	size_t folded_size = 0;
+	uint32_t original_size = 0;
+	uint32_t next_in = 0; // original offset that continues the last run
+
+	friend class TextFolder;
+
+	void clear() {
+		run_out.assign(1, 0);
+		run_in.assign(1, 0);
+		next_in = 0;
+	}
+
+	// Folded bytes from at on come from in on, one for one
+	void map(size_t at, uint32_t in, size_t count = 1) {
+		if (in != next_in) {
+			run_out.push_back(uint32_t(at));
+			run_in.push_back(in);
+		}
+		next_in = in + uint32_t(count);
+	}
+
+public:
+	// Offset in the original text of folded byte p, the original size for the end
+	size_t original(size_t p) const {
+		if (p >= folded_size) return original_size;
+		size_t r = size_t(std::upper_bound(run_out.begin(), run_out.end(), uint32_t(p)) - run_out.begin()) - 1;
+		return run_in[r] + (p - run_out[r]);
+	}
+
+	// First folded offset at or after from that comes from original offset in or later
+	size_t folded(size_t in, size_t from = 0) const {
+		size_t lo = from, hi = folded_size;
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (original(mid) < in) lo = mid + 1; else hi = mid;
+		}
+		return lo;
+	}
+
+	size_t runs() const { return run_out.size(); }
+};
+
+class TextFolder {
+	struct Entry {
+		uint8_t len; // 0: unchanged
+		char utf8[7];
+	};
+	using Block = std::array<Entry, 256>;
+
+	struct Table {
+		std::vector<Block> blocks; // block 0 maps nothing
+		std::vector<uint16_t> index; // code point >> 8 -> block
+		bool ascii_target[128] = {}; // reachable from a non-ASCII code point
+
+		Table() : blocks(1, Block{}), index(0x110000 >> 8, 0) {}
+
+		static int encode(uint32_t cp, char* out) {
+			if (cp < 0x80) { out[0] = char(cp); return 1; }
+			if (cp < 0x800) { out[0] = char(0xC0 | cp >> 6); out[1] = char(0x80 | (cp & 0x3F)); return 2; }
+			if (cp < 0x10000) {
+				out[0] = char(0xE0 | cp >> 12); out[1] = char(0x80 | ((cp >> 6) & 0x3F)); out[2] = char(0x80 | (cp & 0x3F));
+				return 3;
+			}
+			out[0] = char(0xF0 | cp >> 18); out[1] = char(0x80 | ((cp >> 12) & 0x3F));
+			out[2] = char(0x80 | ((cp >> 6) & 0x3F)); out[3] = char(0x80 | (cp & 0x3F));
+			return 4;
+		}
+
+		void set(uint32_t cp, const char* utf8, size_t len) {
+			uint16_t& b = index[cp >> 8];
+			if (b == 0) {
+				b = uint16_t(blocks.size());
+				blocks.emplace_back(Block{});
+			}
+			Entry& e = blocks[b][cp & 0xFF];
+			e.len = uint8_t(len);
+			std::copy(utf8, utf8 + len, e.utf8);
+			if (cp >= 0x80)
+				for (size_t k = 0; k < len; ++k)
+					if ((unsigned char)utf8[k] < 0x80) ascii_target[(unsigned char)utf8[k]] = true;
+		}
+
+		template<size_t N>
+		void add(const fold_tables::FoldRun (&runs)[N]) {
+			for (const auto& r : runs)
+				for (uint32_t cp = r.first; cp <= r.last; cp += r.stride) {
+					if (cp < 0x80) continue; // ASCII is folded inline
+					char buf[4];
+					set(cp, buf, encode(uint32_t(int32_t(cp) + r.delta), buf));
+				}
+		}
+
+		const Entry* find(uint32_t cp) const {
+			if (cp >= 0x110000) return nullptr;
+			const Entry& e = blocks[index[cp >> 8]][cp & 0xFF];
+			return e.len ? &e : nullptr;
+		}
+	};
+
+	static const Table& simple_table() {
+		static const Table t = []() {
+			Table t;
+			t.add(fold_tables::simple_runs);
+			return t;
+		}();
+		return t;
+	}
+
+	static const Table& normalize_table() {
+		static const Table t = []() {
+			Table t;
+			t.add(fold_tables::simple_runs);
+			t.add(fold_tables::normalize_runs);
+			for (const auto& s : fold_tables::normalize_strings)
+				t.set(s.cp, s.utf8, std::char_traits<char>::length(s.utf8));
+			return t;
+		}();
+		return t;
+	}
+
+	const Table* table;
+	bool normalizing;
+	bool joining;
+
+	static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+
+	// Length of a hyphen at s[i], 0 if there is none
+	static size_t hyphen_at(std::string_view s, size_t i) {
+		if (s[i] == '-') return 1;
+		return s[i] == '\xC2' && i + 1 < s.size() && s[i + 1] == '\xAD' ? 2 : 0; // U+00AD soft hyphen
+	}
+
+	// If a line break follows the hyphen that ends before i, the offset behind it and the next line's indent
+	static size_t hyphen_break_end(std::string_view s, size_t i) {
+		while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r')) ++i;
+		if (i >= s.size() || s[i] != '\n') return 0;
+		while (i < s.size() && is_space(s[i])) ++i;
+		return i;
+	}
+
+	// Any byte of an ASCII word that joining rewrites: whitespace, control characters and '-'
+	static bool joins_any(uint64_t w) {
+		const uint64_t ones = 0x0101010101010101ull, highs = 0x8080808080808080ull;
+		uint64_t hyphens = w ^ (ones * '-');
+		return (((w - ones * 0x21) & ~w) | ((hyphens - ones) & ~hyphens)) & highs;
+	}
+
+	// Decodes the UTF-8 sequence at s[i], returns its length or 0 if it is malformed
+	static size_t decode(std::string_view s, size_t i, uint32_t& cp) {
+		unsigned char c = (unsigned char)s[i];
+		size_t len = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 0;
+		if (len == 0 || c >= 0xF8 || i + len > s.size()) return 0;
+		cp = c & (0x7F >> len);
+		for (size_t k = 1; k < len; ++k) {
+			unsigned char d = (unsigned char)s[i + k];
+			if ((d & 0xC0) != 0x80) return 0;
+			cp = cp << 6 | (d & 0x3F);
+		}
+		return len;
+	}
+
+public:
+	explicit TextFolder(bool normalize = false, bool join = false)
+		: table(normalize ? &normalize_table() : &simple_table()), normalizing(normalize), joining(join) {}
+
+	// Joining changes ASCII pages too, every page needs folding
+	bool joins() const { return joining; }
+
+	// Whether joining would drop a hyphen at a line end somewhere in s, only then does it join words
+	static bool has_hyphen_break(std::string_view s) {
+		for (size_t i = s.find_first_of("-\xAD"); i != std::string_view::npos; i = s.find_first_of("-\xAD", i + 1))
+			if ((s[i] == '-' || (i > 0 && s[i - 1] == '\xC2')) && hyphen_break_end(s, i + 1)) return true;
+		return false;
+	}
+
+	// ASCII text folds by the matchers' own ASCII folding, there is nothing to do for it
+	static bool is_ascii(std::string_view s) {
+		size_t i = 0;
+		uint64_t bits = 0;
+		for (; i + 8 <= s.size(); i += 8) {
+			uint64_t w;
+			std::memcpy(&w, s.data() + i, 8);
+			bits |= w;
+		}
+		for (; i < s.size(); ++i) bits |= (unsigned char)s[i];
+		return (bits & 0x8080808080808080ull) == 0;
+	}
+
+	// Whether folding non-ASCII page text can make a difference to finding the folded pattern
+	bool affects(std::string_view folded_pattern) const {
+		if (normalizing || joining) return true; // e.g. fullwidth digits or punctuation
+		for (unsigned char c : folded_pattern)
+			if (c >= 0x80 || table->ascii_target[c]) return true;
+		return false;
+	}
+
+	// Folded copy of s. With ascii false only non-ASCII code points are replaced, for regular expressions
+	// whose escapes are case sensitive and which match ASCII case-insensitively themselves.
+	std::string fold(std::string_view s, bool ascii = true) const {
+		std::string out;
+		fold(s, out, nullptr, ascii);
+		return out;
+	}
+
+	// Folds s into out. offsets, if given, receives where in s every byte of out comes from.
+	void fold(std::string_view s, std::string& out, OffsetMap* offsets, bool ascii = true) const {
+		if (offsets) fold_into<true>(s, out, offsets, ascii);
+		else fold_into<false>(s, out, offsets, ascii);
+	}
+
+private:
+	template<bool Map>
+	void fold_into(std::string_view s, std::string& out, OffsetMap* offsets, bool ascii) const {
+		// Written through a raw pointer into a buffer that grows ahead of the longest replacement
+		size_t cap = s.size() + s.size() / 8 + 16;
+		out.resize(cap);
+		if (Map) offsets->clear();
+		char* o = &out[0];
+		size_t n = 0;
+		for (size_t i = 0; i < s.size();) {
+			if (cap - n < 8) {
+				cap *= 2;
+				out.resize(cap);
+				o = &out[0];
+			}
+			// ASCII runs 8 bytes at a time, A-Z found by the carries of two additions
+			uint64_t w;
+			if (i + 8 <= s.size() && (std::memcpy(&w, s.data() + i, 8), (w & 0x8080808080808080ull) == 0) && !(joining && joins_any(w))) {
+				if (ascii) {
+					uint64_t upper = ((w + 0x3F3F3F3F3F3F3F3Full) ^ (w + 0x2525252525252525ull)) & 0x8080808080808080ull;
+					w |= upper >> 2;
+				}
+				std::memcpy(o + n, &w, 8);
+				if (Map) offsets->map(n, uint32_t(i), 8);
+				n += 8;
+				i += 8;
+				continue;
+			}
+			unsigned char c = (unsigned char)s[i];
+			if (joining) {
+				if (is_space(char(c))) { // a run is one space, mapped to its first byte
+					if (n > 0 && o[n - 1] != ' ') {
+						o[n] = ' ';
+						if (Map) offsets->map(n, uint32_t(i));
+						++n;
+					}
+					++i;
+					continue;
+				}
+				size_t hyphen = hyphen_at(s, i);
+				size_t joined = hyphen && n > 0 && o[n - 1] != ' ' ? hyphen_break_end(s, i + hyphen) : 0;
+				if (joined) {
+					i = joined;
+					continue;
+				}
+			}
+			if (c < 0x80) {
+				o[n] = ascii && c >= 'A' && c <= 'Z' ? char(c + 32) : char(c);
+				if (Map) offsets->map(n, uint32_t(i));
+				++n;
+				++i;
+				continue;
+			}
+			uint32_t cp;
+			size_t len = decode(s, i, cp);
+			const Entry* e = len ? table->find(cp) : nullptr;
+			if (!len) len = 1; // malformed, copied as is
+			const char* src = e ? e->utf8 : s.data() + i;
+			size_t out_len = e ? e->len : len;
+			std::memcpy(o + n, src, out_len);
+			if (Map) {
+				// One code point of the same length continues the run, the bytes of anything else all map to the
+				// start of the sequence they replace
+				unsigned char lead = (unsigned char)src[0];
+				size_t lead_len = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+				if (out_len == len && lead_len == len) offsets->map(n, uint32_t(i), len);
+				else for (size_t k = 0; k < out_len; ++k) offsets->map(n + k, uint32_t(i));
+			}
+			n += out_len;
+			i += len;
+		}
+		out.resize(n);
+		if (Map) {
+			offsets->folded_size = n;
+			offsets->original_size = uint32_t(s.size());
+		}
+	}
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Long-lived worker threads shared by the searches of a SearchEngine, so a query doesn't pay for starting its threads.
+// The stages of a search block on each other's queues and must all run at the same time, so a task never waits
+// for a free worker: if none is idle another one is started. The pool grows to the peak number of concurrent
+// stages and keeps its threads until it is destroyed.
+class ThreadPool {
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::deque<std::function<void()>> tasks;
+	std::vector<std::thread> workers;
+	size_t idle = 0;
+	bool stopping = false;
+
+	void work() {
+		std::unique_lock<std::mutex> lock(mtx);
+		while (true) {
+			idle++;
+			cv.wait(lock, [&]() { return stopping || !tasks.empty(); });
+			idle--;
+			if (tasks.empty())
+				return; // stopping
+			auto task = std::move(tasks.front());
+			tasks.pop_front();
+			lock.unlock();
+			task();
+			task = nullptr; // captures are released before the worker is counted as idle again
+			lock.lock();
+		}
+	}
+
+public:
+	ThreadPool() = default;
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Runs the queued tasks to the end, tasks must not be submitted anymore
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			stopping = true;
+		}
+		cv.notify_all();
+		for (auto& t : workers) t.join();
+	}
+
+	// Starts task on an idle worker, or on a new one if all are busy
+	void run(std::function<void()> task) {
+		std::lock_guard<std::mutex> lock(mtx);
+		tasks.push_back(std::move(task));
+		if (tasks.size() > idle)
+			workers.emplace_back([this]() { work(); });
+		else
+			cv.notify_one();
+	}
+
+	// Threads started so far
+	size_t size() {
+		std::lock_guard<std::mutex> lock(mtx);
+		return workers.size();
+	}
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "SearchResult.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// --rank: what --top orders files by
+enum class Rank {
+	hits,    // occurrences
+	density, // occurrences per page of the document
+	bm25,    // Okapi BM25 from the index, known before a file is searched
+};
+
+// --top: the best k files of a search, kept by the search threads as files complete. A min-heap under a mutex
+// holds the results themselves, so memory stays at k results however many files match. Once it is full its lowest
+// score is the running threshold: worse files are turned away without taking the lock, and with scores known up
+// front (bm25) the readers skip them before reading.
+class TopK {
+public:
+	struct Entry {
+		double score;
+		std::shared_ptr<SearchResult> result;
+	};
+
+	const size_t k;
+	const Rank rank;
+
+	TopK(size_t k, Rank rank) : k(std::max<size_t>(1, k)), rank(rank) {}
+
+	// Score of a completed file, bm25 is its score from the index
+	double score(size_t occurrences, int pages, double bm25) const {
+		switch (rank) {
+		case Rank::hits: return double(occurrences);
+		case Rank::density: return double(occurrences) / std::max(1, pages);
+		case Rank::bm25: return bm25;
+		}
+		return 0;
+	}
+
+	// Files scoring below it can't get in anymore, -infinity until k files were kept
+	double threshold() const { return threshold_.load(std::memory_order_relaxed); }
+
+	// Keeps a completed result if it is among the best k so far, returns false otherwise. A result pushed out
+	// by a better one is released.
+	bool offer(double score, std::shared_ptr<SearchResult> result) {
+		if (score < threshold())
+			return false;
+		Entry e{ score, std::move(result) };
+		std::shared_ptr<SearchResult> evicted; // released after the lock
+		std::lock_guard<std::mutex> lock(mtx);
+		if (heap.size() == k) {
+			if (!better(e, heap.front()))
+				return false;
+			std::pop_heap(heap.begin(), heap.end(), better);
+			evicted = std::move(heap.back().result);
+			heap.back() = std::move(e);
+		} else {
+			heap.push_back(std::move(e));
+		}
+		std::push_heap(heap.begin(), heap.end(), better);
+		if (heap.size() == k)
+			threshold_.store(heap.front().score, std::memory_order_relaxed);
+		return true;
+	}
+
+	// The kept results best first, ties in path order, called once the search is over
+	std::vector<Entry> take() {
+		std::lock_guard<std::mutex> lock(mtx);
+		std::sort_heap(heap.begin(), heap.end(), better);
+		std::vector<Entry> best;
+		best.swap(heap);
+		return best;
+	}
+
+private:
+	std::mutex mtx;
+	std::vector<Entry> heap; // front is the worst kept
+	std::atomic<double> threshold_{ -std::numeric_limits<double>::infinity() };
+
+	static bool better(const Entry& a, const Entry& b) {
+		if (a.score != b.score) return a.score > b.score;
+		return a.result->getPdfPath() < b.result->getPdfPath();
+	}
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+
+// Per thread work deque: the owner takes from the front, other threads steal from the back.
+template<typename T>
+class WorkDeque {
+	std::mutex mtx;
+	std::deque<T> items;
+public:
+	void push(T item) {
+		std::lock_guard<std::mutex> lock(mtx);
+		items.push_back(std::move(item));
+	}
+
+	bool pop(T& item) {
+		std::lock_guard<std::mutex> lock(mtx);
+		if (items.empty()) return false;
+		item = std::move(items.front());
+		items.pop_front();
+		return true;
+	}
+
+	bool steal(T& item) {
+		std::lock_guard<std::mutex> lock(mtx);
+		if (items.empty()) return false;
+		item = std::move(items.back());
+		items.pop_back();
+		return true;
+	}
+};
@@ -0,0 +1,696 @@
+#include "util.hpp"
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace pdf {
+	std::vector<fs::path> get_pdf_files(const fs::path& directory, bool shuffle, size_t walk_threads) {
+		std::vector<fs::path> pdf_files;
+		std::mutex files_mutex;
+		DirectoryCrawler::crawl(directory, walk_threads, [&](std::vector<fs::path>& files) {
+			std::lock_guard<std::mutex> lock(files_mutex);
+			pdf_files.insert(pdf_files.end(), std::make_move_iterator(files.begin()), std::make_move_iterator(files.end()));
+		});
+		std::sort(pdf_files.begin(), pdf_files.end()); // the parallel walk has no stable order
+		if (shuffle) {
+			std::random_device rd;
+			std::mt19937 g(rd());
+			std::shuffle(pdf_files.begin(), pdf_files.end(), g);
+		}
+		return pdf_files;
+	}
+
+	std::vector<size_t> largest_first_order(const std::vector<fs::path>& files) {
+		std::vector<uintmax_t> sizes(files.size());
+		for (size_t i = 0; i < files.size(); ++i) {
+			std::error_code ec;
+			sizes[i] = fs::file_size(files[i], ec);
+			if (ec) sizes[i] = 0;
+		}
+		std::vector<size_t> order(files.size());
+		for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+		return order;
+	}
+
+	void suppress_poppler_stderr() {
+		poppler::set_debug_error_function([](const std::string&, void*) {}, nullptr);
+	}
+
+	bool read_file_into(const fs::path& path, char* data, size_t size) {
+	#ifdef _WIN32
+		std::ifstream in(path, std::ios::binary);
+		return in && (size == 0 || bool(in.read(data, std::streamsize(size))));
+	#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+	#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	#endif
+		size_t done = 0;
+		while (done < size) {
+			ssize_t n = ::pread(fd, data + done, size - done, off_t(done));
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) break;
+			done += size_t(n);
+		}
+		::close(fd);
+		return done == size;
+	#endif
+	}
+
+	TextHint text_hint(std::string_view data) {
+		static const Matcher font("/font"), object_stream("/objstm"); // names are case sensitive, a superset is fine
+		if (data.substr(0, 1024).find("%PDF") == std::string_view::npos)
+			return TextHint::unknown; // left to Poppler to reject
+		if (font.find(data) != std::string_view::npos)
+			return TextHint::fonts;
+		return object_stream.find(data) != std::string_view::npos ? TextHint::unknown : TextHint::none;
+	}
+
+	bool has_fonts(const poppler::document& doc) {
+		std::unique_ptr<poppler::font_iterator> it(doc.create_font_iterator());
+		while (it && it->has_next())
+			if (!it->next().empty()) return true;
+		return false;
+	}
+
+	// ustring::to_utf8() converts into a fresh byte_array that would still be copied into the page buffer,
+	// this sizes out first and writes it in one pass
+	void utf16_to_utf8(const poppler::ustring& in, std::string& out) {
+		const unsigned short* s = in.data();
+		const size_t n = in.size();
+		auto is_pair = [&](size_t i) {
+			return s[i] >= 0xD800 && s[i] < 0xDC00 && i + 1 < n && s[i + 1] >= 0xDC00 && s[i + 1] < 0xE000;
+		};
+		size_t size = 0;
+		for (size_t i = 0; i < n; ++i) {
+			unsigned c = s[i];
+			if (c < 0x80) size += 1;
+			else if (c < 0x800) size += 2;
+			else if (is_pair(i)) { size += 4; ++i; }
+			else size += 3;
+		}
+		out.resize(size);
+		char* p = &out[0];
+		for (size_t i = 0; i < n; ++i) {
+			unsigned c = s[i];
+			if (c < 0x80) {
+				*p++ = char(c);
+			} else if (c < 0x800) {
+				*p++ = char(0xC0 | (c >> 6));
+				*p++ = char(0x80 | (c & 0x3F));
+			} else if (is_pair(i)) {
+				c = 0x10000 + ((c - 0xD800) << 10) + (s[++i] - 0xDC00);
+				*p++ = char(0xF0 | (c >> 18));
+				*p++ = char(0x80 | ((c >> 12) & 0x3F));
+				*p++ = char(0x80 | ((c >> 6) & 0x3F));
+				*p++ = char(0x80 | (c & 0x3F));
+			} else {
+				if (c >= 0xD800 && c < 0xE000) c = 0xFFFD;
+				*p++ = char(0xE0 | (c >> 12));
+				*p++ = char(0x80 | ((c >> 6) & 0x3F));
+				*p++ = char(0x80 | (c & 0x3F));
+			}
+		}
+	}
+
+	void page_text(const poppler::page& page, std::string& out, const poppler::rectf& region) {
+		utf16_to_utf8(page.text(region), out);
+	}
+
+	bool parse_region(const std::string& s, poppler::rectf& region) {
+		double x, y, w, h;
+		char end;
+		if (std::sscanf(s.c_str(), "%lf,%lf,%lf,%lf%c", &x, &y, &w, &h, &end) != 4 || w <= 0 || h <= 0)
+			return false;
+		region = poppler::rectf(x, y, w, h);
+		return true;
+	}
+
+	bool extract_pages(const std::string& pdf_path, std::vector<std::string>& pages) {
+		std::unique_ptr<poppler::document> doc;
+		try {
+			doc.reset(poppler::document::load_from_file(pdf_path));
+		} catch (...) {}
+		if (!doc) return false;
+
+		pages.assign(doc->pages(), std::string());
+		for (int i = 0; i < (int)pages.size(); ++i) {
+			auto page = std::unique_ptr<poppler::page>(doc->create_page(i));
+			if (!page) continue;
+			page_text(*page, pages[i]);
+		}
+		return true;
+	}
+
+	std::string tolower(const std::string& s) {
+		std::string ret = s;
+		std::transform(ret.begin(),ret.end(),ret.begin(),[](unsigned char c) {return std::tolower(c);});
+		return ret;
+	}
+
+	uint64_t fnv1a(const std::string& s) {
+		uint64_t h = 14695981039346656037ull;
+		for (unsigned char c : s) {
+			h ^= c;
+			h *= 1099511628211ull;
+		}
+		return h;
+	}
+
+	fs::path temp_path(const fs::path& target) {
+	#ifdef _WIN32
+		static const unsigned long pid = GetCurrentProcessId();
+	#else
+		static const unsigned long pid = (unsigned long)::getpid();
+	#endif
+		static const uint32_t salt = std::random_device()();
+		static std::atomic<uint64_t> counter{ 0 };
+		char suffix[64];
+		snprintf(suffix, sizeof(suffix), ".%lu.%08x.%llu.tmp", pid, salt, (unsigned long long)counter++);
+		fs::path tmp = target;
+		tmp += suffix;
+		return tmp;
+	}
+
+	fs::path default_cache_dir() {
+	#ifdef _WIN32
+		if (const char* local = std::getenv("LOCALAPPDATA"))
+			return fs::path(local) / "pdfms";
+	#else
+		if (const char* xdg = std::getenv("XDG_CACHE_HOME"))
+			return fs::path(xdg) / "pdfms";
+		if (const char* home = std::getenv("HOME"))
+			return fs::path(home) / ".cache" / "pdfms";
+	#endif
+		return fs::temp_directory_path() / "pdfms";
+	}
+};
+
+namespace terminal {
+	void enable_ansi_escape_codes() {
+	#ifdef _WIN32
+		HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+		if (hOut == INVALID_HANDLE_VALUE) return;
+		DWORD dwMode = 0;
+		if (!GetConsoleMode(hOut, &dwMode)) return;
+		dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+		SetConsoleMode(hOut, dwMode);
+	#endif
+	}
+
+	bool is_terminal() {
+	#ifdef _WIN32
+		return _isatty(_fileno(stdout)) != 0;
+	#else
+		return isatty(STDOUT_FILENO) != 0;
+	#endif
+	}
+
+	int getConsoleWidth() {
+		int columns = 80; // Default or fallback value
+
+	#ifdef _WIN32
+		CONSOLE_SCREEN_BUFFER_INFO csbi;
+		if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi)) {
+			columns = csbi.srWindow.Right - csbi.srWindow.Left + 1;
+		}
+	#elif defined(__linux__) || defined(__APPLE__)
+		struct winsize w;
+		if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0) {
+			columns = w.ws_col;
+		}
+	#endif
+		return columns;
+	}
+
+	void delete_last_lines(int count) {
+		for (int i = 0; i < count; ++i) // Loop count-1 times to move up and clear
+			std::cout << "\033[1A" // Move cursor up
+	#if 0 // clear line
+					  << "\033[2K\r";  // Clear entire line and return cursor to beginning
+	#else // overwrite line, no flicker
+					  << "\r";	// Clear entire line and return cursor to beginning
+	#endif
+		std::cout.flush();
+	}
+
+	void clear_last_lines(int count) {
+		if (count > 0)
+			std::cout << "\033[" << count << "F\033[J";
+	}
+
+	int display_columns(const std::string& line) {
+		int columns = 0;
+		for (unsigned char c : line) {
+			if (c == '\t') columns = (columns / 8 + 1) * 8;
+			else if ((c & 0xC0) != 0x80) columns++;
+		}
+		return columns;
+	}
+
+	int display_rows(const std::string& line, int width) {
+		return std::max(1, (display_columns(line) + width - 1) / std::max(1, width));
+	}
+
+	std::atomic<bool> resized{ true };
+
+	void watch_resize() {
+	#ifdef SIGWINCH
+		std::signal(SIGWINCH, [](int) { resized = true; });
+	#endif
+	}
+
+	bool consume_resize() {
+	#ifdef SIGWINCH
+		return resized.exchange(false);
+	#else
+		return true;
+	#endif
+	}
+
+	void reset_cursor(int lineCount) {
+		if (lineCount > 0) {
+			// \033[F moves cursor to the beginning of the previous line, N times
+			std::cout << "\033[" << lineCount << "F";
+			// \033[J clears from cursor to end of screen
+			//std::cout << "\033[J";
+		}
+	}
+};
+
+namespace json {
+	std::string quote(std::string_view s) {
+		std::string out = "\"";
+		for (unsigned char c : s) {
+			switch (c) {
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (c < 0x20) {
+					char esc[8];
+					snprintf(esc, sizeof(esc), "\\u%04x", c);
+					out += esc;
+				} else {
+					out += char(c);
+				}
+			}
+		}
+		return out + "\"";
+	}
+
+	namespace {
+		void skip_space(std::string_view s, size_t& i) {
+			while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n')) ++i;
+		}
+
+		void append_utf8(std::string& out, uint32_t cp) {
+			if (cp < 0x80) {
+				out += char(cp);
+			} else if (cp < 0x800) {
+				out += char(0xC0 | (cp >> 6));
+				out += char(0x80 | (cp & 0x3F));
+			} else if (cp < 0x10000) {
+				out += char(0xE0 | (cp >> 12));
+				out += char(0x80 | ((cp >> 6) & 0x3F));
+				out += char(0x80 | (cp & 0x3F));
+			} else {
+				out += char(0xF0 | (cp >> 18));
+				out += char(0x80 | ((cp >> 12) & 0x3F));
+				out += char(0x80 | ((cp >> 6) & 0x3F));
+				out += char(0x80 | (cp & 0x3F));
+			}
+		}
+
+		bool hex4(std::string_view s, size_t i, uint32_t& v) {
+			if (i + 4 > s.size()) return false;
+			v = 0;
+			for (size_t k = i; k < i + 4; ++k) {
+				char c = s[k];
+				int d = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+				if (d < 0) return false;
+				v = v << 4 | uint32_t(d);
+			}
+			return true;
+		}
+
+		// s[i] is the opening quote
+		bool parse_string(std::string_view s, size_t& i, std::string& out) {
+			out.clear();
+			for (++i; i < s.size(); ++i) {
+				char c = s[i];
+				if (c == '"') { ++i; return true; }
+				if (c != '\\') { out += c; continue; }
+				if (++i >= s.size()) return false;
+				switch (s[i]) {
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u': {
+					uint32_t cp;
+					if (!hex4(s, i + 1, cp)) return false;
+					i += 4;
+					uint32_t low;
+					if (cp >= 0xD800 && cp < 0xDC00 && i + 2 < s.size() && s[i + 1] == '\\' && s[i + 2] == 'u'
+						&& hex4(s, i + 3, low) && low >= 0xDC00 && low < 0xE000) {
+						cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+						i += 6;
+					} else if (cp >= 0xD800 && cp < 0xE000) {
+						cp = 0xFFFD;
+					}
+					append_utf8(out, cp);
+					break;
+				}
+				default: return false;
+				}
+			}
+			return false;
+		}
+
+		// A string, number or literal
+		bool parse_scalar(std::string_view s, size_t& i, std::string& out) {
+			if (i < s.size() && s[i] == '"') return parse_string(s, i, out);
+			size_t start = i;
+			while (i < s.size() && s[i] != ',' && s[i] != '}' && s[i] != ']' && s[i] != ' ') ++i;
+			out.assign(s.substr(start, i - start));
+			return i > start;
+		}
+	}
+
+	bool parse_object(std::string_view s, std::map<std::string, Value>& fields) {
+		fields.clear();
+		size_t i = 0;
+		skip_space(s, i);
+		if (i >= s.size() || s[i++] != '{') return false;
+		skip_space(s, i);
+		if (i < s.size() && s[i] == '}') return true;
+		while (i < s.size()) {
+			std::string key;
+			if (s[i] != '"' || !parse_string(s, i, key)) return false;
+			skip_space(s, i);
+			if (i >= s.size() || s[i++] != ':') return false;
+			skip_space(s, i);
+			Value& v = fields[key];
+			if (i < s.size() && s[i] == '[') {
+				v.is_array = true;
+				++i;
+				skip_space(s, i);
+				while (i < s.size() && s[i] != ']') {
+					v.items.emplace_back();
+					if (!parse_scalar(s, i, v.items.back())) return false;
+					skip_space(s, i);
+					if (i < s.size() && s[i] == ',') ++i;
+					skip_space(s, i);
+				}
+				if (i++ >= s.size()) return false;
+			} else if (!parse_scalar(s, i, v.text)) {
+				return false;
+			}
+			skip_space(s, i);
+			if (i >= s.size()) return false;
+			if (s[i] == '}') return true;
+			if (s[i++] != ',') return false;
+			skip_space(s, i);
+		}
+		return false;
+	}
+};
+
+namespace net {
+#ifndef _WIN32
+	namespace {
+		bool unix_address(const fs::path& path, sockaddr_un& addr) {
+			std::memset(&addr, 0, sizeof(addr));
+			addr.sun_family = AF_UNIX;
+			const std::string& native = path.native();
+			if (native.size() >= sizeof(addr.sun_path)) return false;
+			std::memcpy(addr.sun_path, native.c_str(), native.size() + 1);
+			return true;
+		}
+
+		// "host:port", "[v6]:port" or ":port"
+		bool split_address(const std::string& address, std::string& host, std::string& port) {
+			size_t colon = address.rfind(':');
+			if (colon == std::string::npos || colon + 1 == address.size()) return false;
+			host = address.substr(0, colon);
+			port = address.substr(colon + 1);
+			if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+				host = host.substr(1, host.size() - 2);
+			return true;
+		}
+
+		addrinfo* resolve(const std::string& address, bool passive, std::string& error) {
+			std::string host, port;
+			if (!split_address(address, host, port)) {
+				error = "expected host:port, got " + address;
+				return nullptr;
+			}
+			addrinfo hints{};
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+			hints.ai_flags = passive ? AI_PASSIVE : 0;
+			addrinfo* list = nullptr;
+			int rc = ::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &list);
+			if (rc != 0) {
+				error = address + ": " + gai_strerror(rc);
+				return nullptr;
+			}
+			return list;
+		}
+	}
+
+	int listen_unix(const fs::path& path, std::string& error) {
+		sockaddr_un addr;
+		if (!unix_address(path, addr)) {
+			error = "socket path too long: " + path.string();
+			return -1;
+		}
+		int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		mode_t old_mask = ::umask(077); // only this user may connect
+		bool bound = fd >= 0 && ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+		::umask(old_mask);
+		if (!bound || ::listen(fd, 64) != 0) {
+			error = "can't listen on " + path.string() + ": " + std::strerror(errno);
+			if (fd >= 0) ::close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	int listen_tcp(const std::string& address, std::string& error) {
+		addrinfo* list = resolve(address, true, error);
+		if (!list) return -1;
+		int fd = -1;
+		for (addrinfo* a = list; a && fd < 0; a = a->ai_next) {
+			fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+			if (fd < 0) continue;
+			int on = 1;
+			::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)); // restarts don't wait for TIME_WAIT
+			if (::bind(fd, a->ai_addr, a->ai_addrlen) != 0 || ::listen(fd, 64) != 0) {
+				error = "can't listen on " + address + ": " + std::strerror(errno);
+				::close(fd);
+				fd = -1;
+			}
+		}
+		::freeaddrinfo(list);
+		return fd;
+	}
+
+	bool is_loopback(const std::string& address) {
+		std::string error;
+		addrinfo* list = resolve(address, true, error); // as listen_tcp resolves it, ":port" is every interface
+		if (!list) return false;
+		bool loopback = true;
+		for (addrinfo* a = list; a; a = a->ai_next) {
+			if (a->ai_family == AF_INET)
+				loopback &= (ntohl(reinterpret_cast<const sockaddr_in*>(a->ai_addr)->sin_addr.s_addr) >> 24) == 127;
+			else if (a->ai_family == AF_INET6)
+				loopback &= IN6_IS_ADDR_LOOPBACK(&reinterpret_cast<const sockaddr_in6*>(a->ai_addr)->sin6_addr);
+			else
+				loopback = false;
+		}
+		::freeaddrinfo(list);
+		return loopback;
+	}
+
+	int connect_unix(const fs::path& path) {
+		sockaddr_un addr;
+		if (!unix_address(path, addr)) return -1;
+		int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) return -1;
+		if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+			::close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	int connect_tcp(const std::string& address) {
+		std::string error;
+		addrinfo* list = resolve(address, false, error);
+		if (!list) return -1;
+		int fd = -1;
+		for (addrinfo* a = list; a && fd < 0; a = a->ai_next) {
+			fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+			if (fd >= 0 && ::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+				::close(fd);
+				fd = -1;
+			}
+		}
+		::freeaddrinfo(list);
+		return fd;
+	}
+
+	int accept(int listen_fd) {
+		while (true) {
+			int fd = ::accept(listen_fd, nullptr, nullptr);
+			if (fd >= 0 || (errno != EINTR && errno != ECONNABORTED)) return fd;
+		}
+	}
+
+	bool write_all(int fd, std::string_view s) {
+		while (!s.empty()) {
+			ssize_t n = ::write(fd, s.data(), s.size());
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;
+			s.remove_prefix(size_t(n));
+		}
+		return true;
+	}
+
+	bool read_line(int fd, std::string& buffer, std::string& line, size_t limit) {
+		size_t end;
+		while ((end = buffer.find('\n')) == std::string::npos) {
+			if (buffer.size() >= limit) return false;
+			char chunk[4096];
+			ssize_t n = ::read(fd, chunk, sizeof(chunk));
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;
+			buffer.append(chunk, size_t(n));
+		}
+		line = buffer.substr(0, end);
+		buffer.erase(0, end + 1);
+		return true;
+	}
+
+	void set_receive_timeout(int fd, int seconds) {
+		timeval tv{};
+		tv.tv_sec = seconds;
+		::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	}
+
+	void shutdown(int fd) { ::shutdown(fd, SHUT_RDWR); }
+	void close(int fd) { ::close(fd); }
+#else
+	int listen_unix(const fs::path&, std::string& error) { error = "Unix domain sockets aren't supported by this build"; return -1; }
+	int listen_tcp(const std::string&, std::string& error) { error = "sockets aren't supported by this build"; return -1; }
+	bool is_loopback(const std::string&) { return false; }
+	int connect_unix(const fs::path&) { return -1; }
+	int connect_tcp(const std::string&) { return -1; }
+	int accept(int) { return -1; }
+	bool write_all(int, std::string_view) { return false; }
+	bool read_line(int, std::string&, std::string&, size_t) { return false; }
+	void set_receive_timeout(int, int) {}
+	void shutdown(int) {}
+	void close(int) {}
+#endif
+};
+
+namespace cpu {
+#ifdef __linux__
+	namespace {
+		// "0-3,8,10-11" as in the cpulist files
+		std::vector<int> parse_list(const std::string& list) {
+			std::vector<int> cpus;
+			std::istringstream in(list);
+			std::string part;
+			while (std::getline(in, part, ',')) {
+				int first = 0, last = 0;
+				int n = std::sscanf(part.c_str(), "%d-%d", &first, &last);
+				if (n < 1) continue;
+				if (n == 1) last = first;
+				for (int c = first; c <= last; ++c) cpus.push_back(c);
+			}
+			return cpus;
+		}
+	}
+
+	std::vector<int> thread_cpus() {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+			return {};
+		std::vector<int> cpus;
+		for (int c = 0; c < CPU_SETSIZE; ++c)
+			if (CPU_ISSET(c, &set)) cpus.push_back(c);
+		return cpus;
+	}
+
+	bool pin_thread(const std::vector<int>& cpus) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int c : cpus)
+			if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+		return CPU_COUNT(&set) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+	}
+
+	std::vector<std::vector<int>> numa_nodes() {
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		bool known = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+		auto usable = [&](int c) { return c >= 0 && c < CPU_SETSIZE && (!known || CPU_ISSET(c, &allowed)); };
+
+		std::vector<std::vector<int>> nodes;
+		std::error_code ec;
+		for (const auto& entry : fs::directory_iterator("/sys/devices/system/node", ec)) {
+			std::string name = entry.path().filename().string();
+			if (name.compare(0, 4, "node") != 0 || name.size() == 4 || !std::isdigit((unsigned char)name[4]))
+				continue;
+			std::ifstream in(entry.path() / "cpulist");
+			std::string list;
+			if (!std::getline(in, list))
+				continue;
+			std::vector<int> cpus;
+			for (int c : parse_list(list))
+				if (usable(c)) cpus.push_back(c);
+			if (!cpus.empty())
+				nodes.push_back(std::move(cpus));
+		}
+		if (nodes.empty()) {
+			std::vector<int> cpus;
+			for (int c = 0; c < CPU_SETSIZE; ++c)
+				if (known ? CPU_ISSET(c, &allowed) : c < int(std::thread::hardware_concurrency())) cpus.push_back(c);
+			nodes.push_back(std::move(cpus));
+		}
+		std::sort(nodes.begin(), nodes.end()); // directory order is arbitrary, by first CPU
+		return nodes;
+	}
+#else
+	std::vector<std::vector<int>> numa_nodes() {
+		std::vector<int> cpus;
+		for (int c = 0; c < int(std::max(1u, std::thread::hardware_concurrency())); ++c) cpus.push_back(c);
+		return { cpus };
+	}
+	bool pin_thread(const std::vector<int>&) { return false; }
+	std::vector<int> thread_cpus() { return {}; }
+#endif
+};
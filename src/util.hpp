@@ -1,86 +1,194 @@
 #pragma once
 
+#include "DirectoryCrawler.hpp"
+#include "Matcher.hpp"
+
+#include <map>
+
 namespace pdf {
-	// Get all PDF files in directory (optionally shuffled)
-	std::vector<fs::path> get_pdf_files(const fs::path& directory, bool shuffle) {
-		std::vector<fs::path> pdf_files;
-		for (const auto& entry : fs::recursive_directory_iterator(directory)) {
-			if (entry.is_regular_file() && entry.path().extension() == ".pdf") {
-				pdf_files.push_back(entry.path());
-			}
-		}
-		if (shuffle) {
-			std::random_device rd;
-			std::mt19937 g(rd());
-			std::shuffle(pdf_files.begin(), pdf_files.end(), g);
-		}
-		return pdf_files;
-	}
+	// Get all PDF files in directory, sorted by path (optionally shuffled)
+	std::vector<fs::path> get_pdf_files(const fs::path& directory, bool shuffle, size_t walk_threads = 4);
 
-	void suppress_poppler_stderr() {
-	#ifdef _WIN32
-		freopen("NUL", "w", stderr);
-	#else
-		freopen("/dev/null", "w", stderr);
-	#endif
+	// Permutation of files ordered by size, largest first, so big documents don't end up in the tail of a run
+	std::vector<size_t> largest_first_order(const std::vector<fs::path>& files);
+
+	template<typename T>
+	void apply_order(std::vector<T>& v, const std::vector<size_t>& order) {
+		std::vector<T> sorted;
+		sorted.reserve(order.size());
+		for (size_t i : order) sorted.push_back(std::move(v[i]));
+		v.swap(sorted);
 	}
+
+	// Drops Poppler's error messages at the source, stderr stays usable for our own diagnostics
+	void suppress_poppler_stderr();
 	
-	std::string tolower(const std::string& s) {
-		std::string ret = s;
-		std::transform(ret.begin(),ret.end(),ret.begin(),[](unsigned char c) {return std::tolower(c);});
-		return ret;
-	}
+	// Fills data with the first size bytes of the file, in as few reads as the OS allows
+	bool read_file_into(const fs::path& path, char* data, size_t size);
+
+	// What the raw bytes of a PDF tell about its text, without parsing it
+	enum class TextHint {
+		none,     // no font anywhere, so no text (scans and other image only documents)
+		fonts,    // a font is referenced
+		unknown,  // fonts may hide in compressed object streams, or this doesn't look like a PDF at all
+	};
+
+	// Text can only be drawn with a font, and every font is referenced by a /Font name in some dictionary.
+	// Dictionaries are only ever compressed inside object streams, so without /ObjStm a missing /Font is final.
+	TextHint text_hint(std::string_view data);
+
+	// True if any page of the document uses a font, for documents text_hint() couldn't decide on
+	bool has_fonts(const poppler::document& doc);
+
+	// UTF-16 as Poppler returns it to UTF-8 in out, reusing its capacity. Unpaired surrogates become U+FFFD.
+	void utf16_to_utf8(const poppler::ustring& in, std::string& out);
+
+	// UTF-8 text of a page, only of region if that isn't empty (PDF points from the top left)
+	void page_text(const poppler::page& page, std::string& out, const poppler::rectf& region = poppler::rectf());
+
+	// Parses --region "x,y,width,height"
+	bool parse_region(const std::string& s, poppler::rectf& region);
+
+	// Extract the UTF-8 text of every page. Returns false if Poppler can't load the document.
+	bool extract_pages(const std::string& pdf_path, std::vector<std::string>& pages);
+
+	std::string tolower(const std::string& s);
+
+	// 64-bit FNV-1a, stable across runs and platforms (unlike std::hash)
+	uint64_t fnv1a(const std::string& s);
+
+	// Name next to target to write it under before renaming it into place: process id, a random number drawn
+	// once per process and a counter, so no two writers share one, not even in different processes
+	fs::path temp_path(const fs::path& target);
+
+	// Per-user cache location: %LOCALAPPDATA%\pdfms, $XDG_CACHE_HOME/pdfms or ~/.cache/pdfms
+	fs::path default_cache_dir();
 };
 
 namespace terminal {
-	#ifdef _WIN32
-	void enable_ansi_escape_codes() {
-		HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
-		if (hOut == INVALID_HANDLE_VALUE) return;
-		DWORD dwMode = 0;
-		if (!GetConsoleMode(hOut, &dwMode)) return;
-		dwMode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-		SetConsoleMode(hOut, dwMode);
-	}
-	#else
-	void enable_ansi_escape_codes() {}
-	#endif
+	// Needed by older Windows consoles, nothing to do elsewhere
+	void enable_ansi_escape_codes();
 
-	int getConsoleWidth() {
-		int columns = 80; // Default or fallback value
+	// False when stdout is redirected to a file or a pipe
+	bool is_terminal();
 
-	#ifdef _WIN32
-		CONSOLE_SCREEN_BUFFER_INFO csbi;
-		if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi)) {
-			columns = csbi.srWindow.Right - csbi.srWindow.Left + 1;
-		}
-	#elif defined(__linux__) || defined(__APPLE__)
-		struct winsize w;
-		if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0) {
-			columns = w.ws_col;
-		}
-	#endif
-		return columns;
-	}
+	int getConsoleWidth();
 	
-	void delete_last_lines(int count) {
-		for (int i = 0; i < count; ++i) // Loop count-1 times to move up and clear
-			std::cout << "\033[1A" // Move cursor up
-	#if 0 // clear line
-					  << "\033[2K\r";  // Clear entire line and return cursor to beginning
-	#else // overwrite line, no flicker
-					  << "\r";	// Clear entire line and return cursor to beginning
-	#endif
-		std::cout.flush();
-	}
+	void delete_last_lines(int count);
+
+	// Moves the cursor to the start of the line count lines up and clears everything from there on
+	void clear_last_lines(int count);
+
+	// Columns a line takes on the terminal: tabs advance to the next multiple of 8, UTF-8 sequences count once
+	int display_columns(const std::string& line);
+
+	// Rows a line takes when wrapped at width columns
+	int display_rows(const std::string& line, int width);
+
+	// Set by SIGWINCH, the console width only needs to be queried again after it was raised
+	extern std::atomic<bool> resized;
+
+	void watch_resize();
+
+	// True if the width may have changed since the last call. Without SIGWINCH it has to be queried every time.
+	bool consume_resize();
 
 	// Helper to move cursor up and clear everything below it
-	void reset_cursor(int lineCount) {
-		if (lineCount > 0) {
-			// \033[F moves cursor to the beginning of the previous line, N times
-			std::cout << "\033[" << lineCount << "F";
-			// \033[J clears from cursor to end of screen
-			//std::cout << "\033[J";
+	void reset_cursor(int lineCount);
+};
+
+namespace json {
+
+	// Quoted JSON string, the input is expected to be UTF-8
+	std::string quote(std::string_view s);
+
+	// A value of a flat object: a string (unquoted), a number or literal as written, or an array of those
+	struct Value {
+		std::string text;
+		std::vector<std::string> items;
+		bool is_array = false;
+	};
+
+	// Parses one object without nested objects, like the records of --ndjson. Returns false if it is malformed.
+	bool parse_object(std::string_view s, std::map<std::string, Value>& fields);
+};
+
+// Blocking stream sockets for --serve, --client and --workers, file descriptors on POSIX.
+// Unix domain sockets are local only, TCP addresses are "host:port" ("[::1]:port" for IPv6, ":port" for any).
+// Everything fails on Windows, the callers report that as unsupported.
+namespace net {
+
+	// Listening socket or -1 with a message
+	int listen_unix(const fs::path& path, std::string& error);
+	int listen_tcp(const std::string& address, std::string& error);
+
+	// True if every address a listen_tcp on address would bind to is a loopback one
+	bool is_loopback(const std::string& address);
+
+	// Connected socket or -1
+	int connect_unix(const fs::path& path);
+	int connect_tcp(const std::string& address);
+
+	// Next connection, retried after interruptions, or -1
+	int accept(int listen_fd);
+
+	bool write_all(int fd, std::string_view s);
+
+	// Next line without its line break, buffer keeps what was read beyond it. False at the end of the stream,
+	// on a timeout, or once limit bytes are buffered without a line break (then buffer.size() >= limit)
+	bool read_line(int fd, std::string& buffer, std::string& line, size_t limit = SIZE_MAX);
+
+	// Reads from fd fail after seconds without data
+	void set_receive_timeout(int fd, int seconds);
+
+	// Unblocks a thread reading from fd
+	void shutdown(int fd);
+	void close(int fd);
+};
+
+// Thread placement for --pin. Nodes come from /sys/devices/system/node on Linux; other systems, and machines
+// without NUMA, have one node with every CPU. Only the CPUs the process may run on are listed.
+namespace cpu {
+
+	// CPU numbers per NUMA node, nodes without usable CPUs are left out
+	std::vector<std::vector<int>> numa_nodes();
+
+	// Restricts the calling thread to cpus, false where that isn't supported or was refused
+	bool pin_thread(const std::vector<int>& cpus);
+
+	// CPUs the calling thread may run on, empty if unknown
+	std::vector<int> thread_cpus();
+};
+
+namespace algo {
+
+	// std::sort on threads: chunks are sorted concurrently, then merged pairwise, each round in parallel
+	template<typename T, typename Compare>
+	void parallel_sort(std::vector<T>& v, Compare cmp, size_t threads = std::thread::hardware_concurrency()) {
+		const size_t min_chunk = 4096; // below that a thread costs more than it saves
+		size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, v.size() / min_chunk));
+		if (chunks == 1) {
+			std::sort(v.begin(), v.end(), cmp);
+			return;
+		}
+		std::vector<size_t> bounds;
+		for (size_t c = 0; c <= chunks; ++c)
+			bounds.push_back(v.size() * c / chunks);
+
+		std::vector<std::thread> pool;
+		for (size_t c = 0; c < chunks; ++c)
+			pool.emplace_back([&, c]() { std::sort(v.begin() + bounds[c], v.begin() + bounds[c + 1], cmp); });
+		for (auto& t : pool) t.join();
+
+		for (size_t width = 1; width < chunks; width *= 2) {
+			pool.clear();
+			for (size_t c = 0; c + width < chunks; c += 2 * width) {
+				size_t first = bounds[c], middle = bounds[c + width], last = bounds[std::min(c + 2 * width, chunks)];
+				pool.emplace_back([&, first, middle, last]() {
+					std::inplace_merge(v.begin() + first, v.begin() + middle, v.begin() + last, cmp);
+				});
+			}
+			for (auto& t : pool) t.join();
 		}
 	}
 };
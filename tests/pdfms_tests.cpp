@@ -0,0 +1,347 @@
+// Correctness tests of the hand tuned parts: the SIMD matcher, Aho-Corasick, Unicode folding with its offset
+// map, UTF-16 transcoding, the index lookup and the small JSON and sorting helpers. Each is compared with a
+// plain reference on deterministic random input. Line numbers of joined hits are checked on a whole search.
+//
+// usage: pdfms_tests, exits with 1 if a check failed
+
+#include "../src/util.hpp"
+#include "../src/AhoCorasick.hpp"
+#include "../src/TextFolder.hpp"
+#include "../src/Index.hpp"
+#include "../src/SearchEngine.hpp"
+
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	do { if (!(cond)) { ++failures; std::cerr << __FILE__ << ":" << __LINE__ << ": failed: " #cond "\n"; } } while (0)
+
+static std::string ascii_lower(std::string s) {
+	for (auto& c : s) c = (c >= 'A' && c <= 'Z') ? char(c + 32) : c;
+	return s;
+}
+
+// Text over a small alphabet so needles recur, with both cases, the bytes one bit 0x20 away from letters
+// ('@', '[', '`', '{') and non-ASCII bytes
+static std::string random_text(std::mt19937& rng, size_t n) {
+	static const char alphabet[] = "abcABC@[`{ -\n\xC3\xA9\xE0";
+	std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 2);
+	std::string s(n, ' ');
+	for (auto& c : s) c = alphabet[pick(rng)];
+	return s;
+}
+
+static void test_matcher() {
+	std::mt19937 rng(1);
+	for (int iter = 0; iter < 3000; ++iter) {
+		// Sizes around the 16 and 32 byte chunks, needles long enough to reach past a chunk
+		std::string hay = random_text(rng, rng() % 160);
+		size_t m = 1 + rng() % 40;
+		std::string needle = hay.size() >= m && rng() % 4 ? hay.substr(rng() % (hay.size() - m + 1), m) : random_text(rng, m);
+		const Matcher matcher(ascii_lower(needle));
+		const std::string hay_lower = ascii_lower(hay), needle_lower = ascii_lower(needle);
+		for (size_t from = 0; from <= hay.size() + 1; ++from) {
+			size_t expected = from <= hay.size() ? hay_lower.find(needle_lower, from) : std::string::npos;
+			CHECK(matcher.find_scalar(hay, from) == expected);
+			CHECK(matcher.find(hay, from) == expected);
+		}
+	}
+	// A hit in the last bytes, behind every full chunk, and one across a chunk boundary
+	for (size_t n = 1; n <= 100; ++n) {
+		std::string hay(n, 'x');
+		hay.replace(n - 1, 1, "Y");
+		CHECK(Matcher("y").find(hay) == n - 1);
+		if (n >= 4) {
+			std::string across(n, 'x');
+			across.replace(n / 2 - 1, 3, "ABC");
+			CHECK(Matcher("abc").find(across) == n / 2 - 1);
+			CHECK(Matcher("abc").find(across, n / 2) == std::string::npos);
+		}
+	}
+	CHECK(Matcher("").find("abc", 2) == 2);
+	CHECK(Matcher("abc").find("ab") == std::string::npos);
+}
+
+static void test_aho_corasick() {
+	std::mt19937 rng(2);
+	for (int iter = 0; iter < 1000; ++iter) {
+		std::string text = random_text(rng, rng() % 300);
+		std::vector<std::string> patterns;
+		size_t count = 1 + rng() % 8;
+		for (size_t p = 0; p < count; ++p) {
+			size_t m = 1 + rng() % 6;
+			patterns.push_back(ascii_lower(text.size() >= m && rng() % 2 ? text.substr(rng() % (text.size() - m + 1), m) : random_text(rng, m)));
+		}
+		std::set<std::pair<size_t, int>> found, expected;
+		AhoCorasickMatcher(patterns).scan(text, [&](size_t pos, size_t len, int pattern) {
+			CHECK(len == patterns[pattern].size());
+			found.emplace(pos, pattern);
+			return pos; // skips nothing
+		});
+		const std::string lower = ascii_lower(text);
+		for (size_t p = 0; p < patterns.size(); ++p)
+			for (size_t pos = lower.find(patterns[p]); pos != std::string::npos; pos = lower.find(patterns[p], pos + 1))
+				expected.emplace(pos, int(p));
+		CHECK(found == expected);
+	}
+	// Hits before the returned offset are skipped, the automaton restarts there
+	std::vector<size_t> hits;
+	AhoCorasickMatcher({ "ab" }).scan("ab ab ab", [&](size_t pos, size_t, int) {
+		hits.push_back(pos);
+		return pos + 4;
+	});
+	CHECK((hits == std::vector<size_t>{ 0, 6 }));
+}
+
+// Offset in s of every code point boundary of the folded text, and of its end
+static std::vector<size_t> boundary_offsets(const std::string& folded, const OffsetMap& map) {
+	std::vector<size_t> offsets;
+	for (size_t p = 0; p <= folded.size(); ++p)
+		if (p == folded.size() || ((unsigned char)folded[p] & 0xC0) != 0x80) offsets.push_back(map.original(p));
+	return offsets;
+}
+
+static void test_text_folder() {
+	const TextFolder fold(false), normalize(true), join(false, true);
+	CHECK(fold.fold("ÉTÉ Abc") == "été abc");
+	CHECK(fold.fold("ÉTÉ Abc", false) == "éTé Abc"); // ASCII is left to the regex engine
+	CHECK(fold.fold("ΣΑΣ") == "σασ");
+	CHECK(normalize.fold("ﬁne Straße ＡＢＣ") == "fine strasse abc");
+	CHECK(join.fold("perfor-\nmance  of\n\t well-\n   known") == "performance of wellknown");
+	CHECK(join.fold("a - b") == "a - b"); // a hyphen inside a line stays
+
+	std::string out;
+	OffsetMap map;
+	fold.fold("AbC", out, &map);
+	CHECK(out == "abc");
+	CHECK((boundary_offsets(out, map) == std::vector<size_t>{ 0, 1, 2, 3 }));
+
+	// "É" folds to a two byte "é", the map stays on code point boundaries
+	fold.fold("xÉy", out, &map);
+	CHECK(out == "x\xC3\xA9y");
+	CHECK((boundary_offsets(out, map) == std::vector<size_t>{ 0, 1, 3, 4 }));
+
+	// "ß" becomes "ss": both bytes come from the start of the "ß"
+	normalize.fold("aßb", out, &map);
+	CHECK(out == "assb");
+	CHECK((boundary_offsets(out, map) == std::vector<size_t>{ 0, 1, 1, 3, 4 }));
+
+	// "ﬁ" (three bytes) becomes "fi"
+	normalize.fold("\xEF\xAC\x81x", out, &map);
+	CHECK(out == "fix");
+	CHECK((boundary_offsets(out, map) == std::vector<size_t>{ 0, 0, 3, 4 }));
+
+	// A collapsed whitespace run maps to its first byte, a joined hyphen break disappears
+	join.fold("ab-\n cd  \n ef", out, &map);
+	CHECK(out == "abcd ef");
+	CHECK((boundary_offsets(out, map) == std::vector<size_t>{ 0, 1, 5, 6, 7, 11, 12, 13 }));
+	CHECK(map.folded(7) == 4);     // the original "  \n " run is the space
+	CHECK(map.folded(9, 5) == 5);  // the line break inside it, searched from behind the space
+	CHECK(map.folded(13) == 7);
+
+	// Long ASCII runs take the 8 byte path, the map stays one run
+	std::string ascii(100, 'A');
+	fold.fold(ascii, out, &map);
+	CHECK(out == std::string(100, 'a'));
+	CHECK(map.runs() == 1);
+	CHECK(map.original(57) == 57);
+	CHECK(map.original(100) == 100);
+
+	// Malformed UTF-8 is copied as it is
+	CHECK(fold.fold("a\xFF\xC3") == "a\xFF\xC3");
+}
+
+static void test_utf16_to_utf8() {
+	auto convert = [](std::vector<unsigned short> units) {
+		poppler::ustring in(units.size(), 0);
+		for (size_t i = 0; i < units.size(); ++i) in[i] = units[i];
+		std::string out = "stale content that is longer than the result";
+		pdf::utf16_to_utf8(in, out);
+		return out;
+	};
+	CHECK(convert({}) == "");
+	CHECK(convert({ 'A', 0xE9, 0x20AC }) == "A\xC3\xA9\xE2\x82\xAC");
+	CHECK(convert({ 0xD83D, 0xDE00 }) == "\xF0\x9F\x98\x80");               // U+1F600
+	CHECK(convert({ 0xDBFF, 0xDFFF }) == "\xF4\x8F\xBF\xBF");               // U+10FFFF
+	CHECK(convert({ 0xD83D, 'A' }) == "\xEF\xBF\xBD" "A");                  // high surrogate without its pair
+	CHECK(convert({ 'A', 0xDE00 }) == "A\xEF\xBF\xBD");                     // low surrogate on its own
+	CHECK(convert({ 0xD83D }) == "\xEF\xBF\xBD");                           // high surrogate at the end
+	CHECK(convert({ 0xDE00, 0xD83D }) == "\xEF\xBF\xBD\xEF\xBF\xBD");       // pair in the wrong order
+	CHECK(convert({ 0xD83D, 0xD83D, 0xDE00 }) == "\xEF\xBF\xBD\xF0\x9F\x98\x80");
+}
+
+static void test_index_candidates() {
+	std::error_code ec;
+	const fs::path dir = fs::temp_directory_path() / ("pdfms_tests_" + std::to_string(std::random_device()()));
+	fs::create_directories(dir, ec);
+	CHECK(!ec);
+
+	// The builder reads every file's text from the cache, the files only have to exist for their keys
+	static const char* words[] = { "performance", "perform", "Système", "très", "ÉTÉ", "straße", "iso", "9001",
+		"co-operation", "self", "selfish", "fish", "form", "information", "a", "of", "the", "inter-\n", "perfor-\n  " };
+	std::mt19937 rng(3);
+	TextCache cache(fs::path(), true);
+	std::vector<fs::path> files;
+	std::vector<std::vector<std::string>> text;
+	for (int f = 0; f < 12; ++f) {
+		files.push_back(dir / ("file" + std::to_string(f) + ".pdf"));
+		std::ofstream(files.back()) << f;
+		std::vector<std::string> pages(1 + rng() % 4);
+		for (auto& page : pages)
+			for (int w = rng() % 20; w > 0; --w)
+				page += std::string(words[rng() % (sizeof(words) / sizeof(words[0]))]) + (rng() % 5 ? " " : ",\n");
+		FileKey key;
+		CHECK(FileKey::fromPath(files.back(), key));
+		cache.store(key, pages);
+		text.push_back(pages);
+	}
+	PdfIndexBuilder::Stats stats;
+	const fs::path index_path = dir / "test.pdfmsidx";
+	CHECK(PdfIndexBuilder::build(files, cache, index_path, stats));
+	PdfIndex index;
+	CHECK(index.open(index_path));
+	CHECK(index.fileCount() == files.size());
+
+	const TextFolder folder(true), joiner(true, true);
+	std::vector<std::string> queries = { "perf", "form", "orm", "formation", "ish", "fish", "self", "elfi",
+		"ance perf", "co-op", "-operation", "système", "ÈME", "ete", "été", "strasse", "ss", "e, t", "9001", "zzz",
+		"interform", "performance", "perforperform", "r-" };
+	for (int q = 0; q < 200; ++q) { // random slices of the text, starting and ending anywhere
+		const std::string& page = text[rng() % text.size()][0];
+		if (page.size() < 2) continue;
+		size_t start = rng() % (page.size() - 1), len = 1 + rng() % std::min<size_t>(16, page.size() - start);
+		queries.push_back(page.substr(start, len));
+	}
+	for (const auto& query : queries) {
+		for (const TextFolder* f : { &folder, &joiner }) { // as pdfms query folds the patterns without and with --join-lines
+			if (f == &joiner && query.find('\n') != std::string::npos)
+				continue; // patterns are single lines
+			const std::string folded = f->fold(query);
+			std::vector<Posting> candidates;
+			if (!index.candidates(folded, candidates))
+				continue; // no token, every page is a candidate
+			CHECK(std::is_sorted(candidates.begin(), candidates.end()));
+			for (uint32_t file = 0; file < files.size(); ++file)
+				for (uint32_t p = 0; p < text[file].size(); ++p) {
+					if (f->fold(text[file][p]).find(folded) == std::string::npos) continue;
+					bool listed = std::binary_search(candidates.begin(), candidates.end(), Posting{ file, p });
+					CHECK(listed);
+					if (!listed) std::cerr << "  query \"" << query << "\" misses file " << file << " page " << p << (f == &joiner ? " joined\n" : "\n");
+				}
+		}
+	}
+
+	// Explicitly: the joined word of a hyphenated line end
+	std::vector<Posting> candidates;
+	const fs::path hyphenated = dir / "hyphenated.pdf";
+	std::ofstream(hyphenated) << "h";
+	FileKey key;
+	CHECK(FileKey::fromPath(hyphenated, key));
+	cache.store(key, { "high perfor-\nmance computing", "co\xC2\xAD \r\n  operation" });
+	CHECK(PdfIndexBuilder::build({ hyphenated }, cache, index_path, stats));
+	CHECK(index.open(index_path));
+	CHECK(index.candidates("performance", candidates) && (candidates == std::vector<Posting>{ { 0, 0 } }));
+	CHECK(index.candidates("cooperation", candidates) && (candidates == std::vector<Posting>{ { 0, 1 } }));
+	CHECK(index.candidates("mance", candidates) && (candidates == std::vector<Posting>{ { 0, 0 } }));
+	index.close();
+	fs::remove_all(dir, ec);
+}
+
+// Page, line number, line and pattern of every occurrence, searched from cached text so Poppler isn't involved
+static std::vector<std::tuple<int, int, std::string, int>> search_cached(const std::vector<std::string>& pages, SearchEngine::Query query) {
+	std::error_code ec;
+	const fs::path dir = fs::temp_directory_path() / ("pdfms_tests_" + std::to_string(std::random_device()()));
+	fs::create_directories(dir, ec);
+	const fs::path file = dir / "cached.pdf";
+	std::ofstream(file) << "c";
+	SearchEngine::Options options;
+	options.use_cache = true;
+	options.cache_dir = dir / "cache";
+	SearchEngine engine(options);
+	FileKey key;
+	CHECK(FileKey::fromPath(file, key));
+	engine.textCache()->store(key, pages);
+
+	query.walk = false;
+	query.files = { file };
+	std::vector<std::tuple<int, int, std::string, int>> found;
+	std::string error;
+	CHECK(engine.search(query, [&](const SearchResult& result) {
+		for (size_t i = 0; i < result.occurrenceCount(); ++i) {
+			const Occurence& occ = result.sortedOccurrence(i);
+			found.emplace_back(occ.page, occ.line_number, std::string(occ.line()), occ.pattern);
+		}
+	}, error));
+	std::sort(found.begin(), found.end());
+	fs::remove_all(dir, ec);
+	return found;
+}
+
+static void test_joined_lines() {
+	using Hits = std::vector<std::tuple<int, int, std::string, int>>;
+	SearchEngine::Query query;
+	query.join_lines = true;
+	query.patterns = { "quick brown fox", "brown" };
+	// The shorter pattern ends first, the joined hit still belongs to the line it starts on
+	CHECK((search_cached({ "the quick\nbrown fox jumps\nover" }, query)
+		== Hits{ { 1, 1, "the quick brown fox jumps", 0 }, { 1, 2, "brown fox jumps", 1 } }));
+	CHECK((search_cached({ "a\nthe quick\nbrown fox\nbrown quick brown\nfox" }, query)
+		== Hits{ { 1, 2, "the quick brown fox", 0 }, { 1, 3, "brown fox", 1 }, { 1, 4, "brown quick brown", 1 }, { 1, 4, "brown quick brown fox", 0 } }));
+	query.patterns = { "the performance", "mance" };
+	CHECK((search_cached({ "x the perfor-\nmance" }, query) == Hits{ { 1, 1, "x the perfor- mance", 0 }, { 1, 2, "mance", 1 } }));
+	query.patterns = { "quick brown fox", "brown" };
+
+	// A line cut to --max-line keeps the start of the hit
+	query.max_line = 12;
+	Hits clipped = search_cached({ "some words before the quick\nbrown fox" }, query);
+	CHECK(clipped.size() == 2 && std::get<1>(clipped[0]) == 1 && std::get<2>(clipped[0]).rfind("quick", 0) == 0);
+}
+
+static void test_json() {
+	std::map<std::string, json::Value> fields;
+	const std::string line = "\"quote\\\" back\\\\slash\ttab\x01 é\"";
+	CHECK(json::parse_object("{\"file\": " + json::quote(line) + ", \"page\": 3, \"before\": [\"a\", \"b\"], \"after\": []}", fields));
+	CHECK(fields["file"].text == line);
+	CHECK(fields["page"].text == "3");
+	CHECK(fields["before"].is_array && (fields["before"].items == std::vector<std::string>{ "a", "b" }));
+	CHECK(fields["after"].is_array && fields["after"].items.empty());
+	CHECK(json::parse_object("{}", fields) && fields.empty());
+	CHECK(!json::parse_object("{\"a\": 1", fields));
+	CHECK(!json::parse_object("[1]", fields));
+}
+
+static void test_parallel_sort() {
+	std::mt19937 rng(4);
+	for (size_t n : { size_t(0), size_t(1), size_t(4095), size_t(50000), size_t(100003) }) {
+		for (size_t threads : { 1, 2, 3, 8 }) {
+			std::vector<uint32_t> v(n);
+			for (auto& x : v) x = rng() % 1000;
+			std::vector<uint32_t> expected = v;
+			std::sort(expected.begin(), expected.end());
+			algo::parallel_sort(v, std::less<uint32_t>(), threads);
+			CHECK(v == expected);
+		}
+	}
+}
+
+int main() {
+	test_matcher();
+	test_aho_corasick();
+	test_text_folder();
+	test_utf16_to_utf8();
+	test_index_candidates();
+	test_joined_lines();
+	test_json();
+	test_parallel_sort();
+	if (failures) {
+		std::cerr << failures << " checks failed\n";
+		return 1;
+	}
+	std::cout << "all checks passed\n";
+	return 0;
+}
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+# Generates src/FoldTables.hpp from the Unicode database of the running Python.
+#
+# usage: python3 tools/gen_fold_tables.py > src/FoldTables.hpp
+
+import unicodedata
+
+# Blocks that get NFKC normalization, everything else is only case folded
+NORMALIZE_BLOCKS = [
+	(0x00A0, 0x024F),   # Latin-1 Supplement, Latin Extended-A/B
+	(0x1E00, 0x1EFF),   # Latin Extended Additional
+	(0x2000, 0x218F),   # punctuation, super/subscripts, letterlike symbols, number forms
+	(0x2460, 0x24FF),   # enclosed alphanumerics
+	(0xFB00, 0xFB4F),   # alphabetic presentation forms (ligatures)
+	(0xFF00, 0xFFEF),   # halfwidth and fullwidth forms
+	(0x1D400, 0x1D7FF), # mathematical alphanumeric symbols
+]
+MAX_BYTES = 7 # longest replacement a table entry holds
+
+
+def simple_fold(cp):
+	# Python only exposes full folding, take its single code point results (status C) and fall back
+	# to lowercasing where the full folding expands (status S)
+	c = chr(cp)
+	f = c.casefold()
+	if len(f) == 1:
+		return ord(f)
+	l = c.lower()
+	return ord(l) if len(l) == 1 else cp
+
+
+def runs(mapping):
+	# {first, last, stride, delta} runs covering a code point -> code point mapping
+	keys = sorted(mapping)
+	out = []
+	i = 0
+	while i < len(keys):
+		first = keys[i]
+		delta = mapping[first] - first
+		best = (first, first, 1, delta)
+		best_count = 1
+		for stride in (1, 2):
+			last = first
+			while last + stride in mapping and mapping[last + stride] - (last + stride) == delta:
+				last += stride
+			count = (last - first) // stride + 1
+			if count > best_count:
+				best, best_count = (first, last, stride, delta), count
+		out.append(best)
+		covered = set(range(best[0], best[1] + 1, best[2]))
+		while i < len(keys) and keys[i] in covered:
+			i += 1
+	return out
+
+
+def main():
+	simple = {}
+	normalized = {}
+	for cp in range(0x110000):
+		if 0xD800 <= cp < 0xE000:
+			continue
+		s = simple_fold(cp)
+		if s != cp:
+			simple[cp] = s
+		if any(a <= cp <= b for a, b in NORMALIZE_BLOCKS):
+			n = unicodedata.normalize('NFKC', unicodedata.normalize('NFKC', chr(cp)).casefold())
+			if n != chr(s) and len(n.encode()) <= MAX_BYTES:
+				normalized[cp] = n
+
+	single = {k: ord(v) for k, v in normalized.items() if len(v) == 1}
+	strings = sorted((k, v) for k, v in normalized.items() if len(v) > 1)
+
+	def hexcp(v):
+		return '0x%04X' % v
+
+	def esc(s):
+		return ''.join('\\%03o' % b if b >= 0x80 or b < 0x20 or b in (0x22, 0x5C) else chr(b) for b in s.encode())
+
+	def write_runs(name, rs):
+		print('\tinline constexpr FoldRun %s[] = {' % name)
+		for i in range(0, len(rs), 4):
+			print('\t\t' + ' '.join('{ %s, %s, %d, %d },' % (hexcp(a), hexcp(b), st, d) for a, b, st, d in rs[i:i + 4]))
+		print('\t};')
+
+	print('#pragma once')
+	print()
+	print('// Generated by tools/gen_fold_tables.py from Unicode %s, do not edit.' % unicodedata.unidata_version)
+	print()
+	print('#include <cstdint>')
+	print()
+	print('namespace fold_tables {')
+	print('\tstruct FoldRun {')
+	print('\t\tuint32_t first, last; // code points first, first + stride, ... up to last')
+	print('\t\tint stride;')
+	print('\t\tint32_t delta; // added to the code point')
+	print('\t};')
+	print('\tstruct FoldString {')
+	print('\t\tuint32_t cp;')
+	print('\t\tconst char* utf8;')
+	print('\t};')
+	print()
+	print('\t// Simple case folding (CaseFolding.txt status C and S)')
+	write_runs('simple_runs', runs(simple))
+	print()
+	print('\t// NFKC of one code point followed by full case folding, where it differs from the simple folding:')
+	print('\t// Latin, punctuation and letterlike symbols, number forms, enclosed alphanumerics, ligatures,')
+	print('\t// fullwidth forms and mathematical alphanumerics. Single code point results as runs, the others as strings.')
+	write_runs('normalize_runs', runs(single))
+	print()
+	print('\tinline constexpr FoldString normalize_strings[] = {')
+	for i in range(0, len(strings), 6):
+		print('\t\t' + ' '.join('{ %s, "%s" },' % (hexcp(k), esc(v)) for k, v in strings[i:i + 6]))
+	print('\t};')
+	print('};')
+
+
+if __name__ == '__main__':
+	main()